@@ -0,0 +1,236 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+
+#include "batch.h"
+#include "board.h"
+#include "search.h"
+#include "epd.h"
+#include "numa.h"
+
+static std::string jsonEscape(const std::string& text) {
+	std::string escaped;
+	for (char ch : text) {
+		switch (ch) {
+			case '"':  escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:   escaped += ch; break;
+		}
+	}
+	return escaped;
+}
+
+// {"cp":35} or {"mate":3}
+static std::string scoreToJson(int score) {
+	std::string uci = uciScore(score); // "cp 35" or "mate 3"
+	size_t space = uci.find(' ');
+	return "{\"" + uci.substr(0, space) + "\":" + uci.substr(space + 1) + "}";
+}
+
+static std::string pvToJson(const std::vector<std::string>& pv) {
+	std::string json = "[";
+	for (size_t i = 0; i < pv.size(); i++) {
+		json += (i > 0 ? ",\"" : "\"") + pv[i] + "\"";
+	}
+	return json + "]";
+}
+
+static std::string resultToJson(uint64_t index, const EpdRecord& record, bool validFen, const SearchResult& result) {
+	std::stringstream json;
+	json << "{\"index\":" << index;
+	std::string id = record.operation("id");
+	if (!id.empty()) {
+		json << ",\"id\":\"" << jsonEscape(id) << "\"";
+	}
+	json << ",\"fen\":\"" << jsonEscape(record.fen) << "\"";
+	if (!validFen) {
+		json << ",\"error\":\"invalid fen\"}";
+		return json.str();
+	}
+	if (result.bestMove.empty()) {
+		json << ",\"bestmove\":null,\"error\":\"no legal moves\"}";
+		return json.str();
+	}
+
+	json << ",\"bestmove\":\"" << result.bestMove << "\""
+	     << ",\"score\":" << scoreToJson(result.score)
+	     << ",\"depth\":" << result.depth
+	     << ",\"pv\":" << pvToJson(result.pv);
+	if (result.lines.size() > 1) {
+		json << ",\"lines\":[";
+		for (size_t i = 0; i < result.lines.size(); i++) {
+			json << (i > 0 ? "," : "") << "{\"score\":" << scoreToJson(result.lines[i].score)
+			     << ",\"pv\":" << pvToJson(result.lines[i].pv) << "}";
+		}
+		json << "]";
+	}
+	json << ",\"nodes\":" << result.nodes
+	     << ",\"time\":" << result.timeMs << "}";
+	return json.str();
+}
+
+int runBatch(const std::vector<std::string>& args) {
+	std::string inputPath;
+	std::string outputPath;
+	SearchLimits limits;
+	bool depthGiven = false;
+	int threadCount = 0;
+	int multiPV = 1;
+	std::string cachePath;
+	int cacheMB = SEARCH_CACHE_DEFAULT_MB;
+	std::string tracePath;
+	for (size_t i = 0; i < args.size(); i++) {
+		bool hasValue = i + 1 < args.size();
+		if (args[i] == "--depth" && hasValue) {
+			limits.depth = std::atoi(args[++i].c_str());
+			depthGiven = true;
+		} else if (args[i] == "--nodes" && hasValue) {
+			limits.nodes = std::strtoull(args[++i].c_str(), nullptr, 10);
+		} else if (args[i] == "--movetime" && hasValue) {
+			limits.movetime = std::atoi(args[++i].c_str());
+		} else if (args[i] == "--threads" && hasValue) {
+			threadCount = std::atoi(args[++i].c_str());
+		} else if (args[i] == "--multipv" && hasValue) {
+			multiPV = std::max(1, std::atoi(args[++i].c_str()));
+		} else if (args[i] == "--output" && hasValue) {
+			outputPath = args[++i];
+		} else if (args[i] == "--cache" && hasValue) {
+			cachePath = args[++i];
+		} else if (args[i] == "--cache-mb" && hasValue) {
+			cacheMB = std::atoi(args[++i].c_str());
+		} else if (args[i] == "--trace" && hasValue) {
+			tracePath = args[++i];
+		} else if (inputPath.empty() && args[i].rfind("--", 0) != 0) {
+			inputPath = args[i];
+		} else {
+			std::cerr << "Unknown batch option: " << args[i] << std::endl;
+			return 1;
+		}
+	}
+	if (inputPath.empty()) {
+		std::cerr << "Usage: bearbot batch <positions.epd> [--depth N] [--nodes N] [--movetime MS] [--multipv N] [--threads N] [--output FILE] [--cache FILE] [--cache-mb N] [--trace FILE]" << std::endl;
+		return 1;
+	}
+	// With only a node or time limit, let iterative deepening run until the limit hits.
+	if (!depthGiven && (limits.nodes > 0 || limits.movetime > 0)) {
+		limits.depth = MAX_PLY - 1;
+	}
+	if (threadCount < 1) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::ifstream input(inputPath);
+	if (!input) {
+		std::cerr << "Can't open " << inputPath << std::endl;
+		return 1;
+	}
+	std::ofstream outputFile;
+	if (!outputPath.empty()) {
+		outputFile.open(outputPath);
+		if (!outputFile) {
+			std::cerr << "Can't write " << outputPath << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& output = outputPath.empty() ? std::cout : outputFile;
+
+	SearchCache cache;
+	if (!cachePath.empty()) {
+		std::string error;
+		if (!cache.open(cachePath, cacheMB, searchCacheFingerprint(SearchParams()), error)) {
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		std::cerr << "Search cache " << cache.describe() << std::endl;
+	}
+	TraceLog traceLog;
+	if (!tracePath.empty()) {
+		std::string error;
+		if (!traceLog.open(tracePath, error)) {
+			std::cerr << error << std::endl;
+			return 1;
+		}
+	}
+
+	// Workers take the next line from the shared reader and hand their result to the writer,
+	// which holds finished results until everything before them is written. A worker may only
+	// run `window` positions ahead of the writer, so a slow position never makes the
+	// out-of-order results pile up in memory.
+	std::mutex mutex;
+	std::condition_variable writerAdvanced;
+	uint64_t nextIndex = 0;  // index of the next position read from the input
+	uint64_t nextToWrite = 0;
+	std::map<uint64_t, std::string> pending;
+	const uint64_t window = 4 * static_cast<uint64_t>(threadCount);
+
+	auto worker = [&](int workerIndex) {
+		pinWorkerThread(workerIndex);
+		Board board;
+		SearchContext context;
+		context.limits = limits;
+		context.reportInfo = false;
+		context.multiPV = multiPV;
+		context.searchCache = cache.isOpen() ? &cache : nullptr;
+		if (traceLog.isOpen()) {
+			context.trace.reset(new TraceWriter(traceLog));
+		}
+
+		while (true) {
+			uint64_t index;
+			EpdRecord record;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				writerAdvanced.wait(lock, [&]() { return nextIndex < nextToWrite + window; });
+				std::string line;
+				bool found = false;
+				while (std::getline(input, line)) {
+					if (parseEpdLine(line, record)) {
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					return;
+				}
+				index = nextIndex++;
+			}
+
+			SearchResult result;
+			bool validFen = board.loadFen(record.fen);
+			if (validFen) {
+				result = search(board, context);
+			}
+			std::string json = resultToJson(index, record, validFen, result);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			pending[index] = json;
+			while (!pending.empty() && pending.begin()->first == nextToWrite) {
+				output << pending.begin()->second << '\n';
+				pending.erase(pending.begin());
+				nextToWrite++;
+			}
+			output.flush();
+			writerAdvanced.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.emplace_back(worker, t);
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	return 0;
+}
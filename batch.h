@@ -0,0 +1,24 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <string>
+#include <vector>
+
+// Batch analysis: "bearbot batch <positions.epd> [options]"
+//
+//   --depth N       search every position to depth N
+//   --nodes N       stop each search after N nodes
+//   --movetime MS   stop each search after MS milliseconds
+//   --multipv N     also report the best N root moves with their lines ("lines" in the JSON)
+//   --threads N     number of positions analyzed at once (default: all cores)
+//   --output FILE   write results there instead of stdout
+//   --cache FILE    search cache kept across runs, positions analyzed before come from there (see search_cache.h)
+//   --cache-mb N    size limit of the cache file (default 64)
+//   --trace FILE    record every node searched, for "bearbot trace" (see trace.h)
+//
+// The input is read line by line (EPD or FEN, one position per line) and one JSON
+// object per position is written in input order, e.g.
+// {"index":0,"id":"pos1","fen":"...","bestmove":"e2e4","score":{"cp":35},"depth":6,"pv":["e2e4","e7e5"],"nodes":51234,"time":812}
+int runBatch(const std::vector<std::string>& args);
+
+#endif
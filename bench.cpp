@@ -0,0 +1,184 @@
+// Microbenchmarks for the board and move generation primitives.
+//
+// Usage: bearbot-bench [runs] [name filter]
+//
+// Every benchmark does a fixed amount of work over the same set of positions, so the
+// numbers from two builds are directly comparable. Each one is run once to warm up and
+// then `runs` times (default 7); the median is reported, with the fastest run next to it
+// so noisy results stand out.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+
+#include "board.h"
+#include "engine.h"
+
+static const std::vector<std::string> BENCH_FENS = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"2r3k1/pp3ppp/4p3/3pP3/3P4/P4N2/1P3PPP/2R3K1 b - - 3 24",
+	"8/8/4k3/8/2p5/8/B2K4/8 w - - 0 60",
+};
+
+// Written to after every benchmark so the compiler can't throw the work away.
+static volatile uint64_t benchSink = 0;
+
+struct BenchResult {
+	std::string name;
+	uint64_t ops = 0;
+	double medianNs = 0;
+	double minNs = 0;
+};
+
+// Runs work() once to warm up, then `runs` more times. work() returns the number of
+// operations it performed.
+static BenchResult runBench(const std::string& name, int runs, const std::function<uint64_t()>& work) {
+	BenchResult result;
+	result.name = name;
+	result.ops = work();
+
+	std::vector<double> nsPerOp;
+	for (int i = 0; i < runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		uint64_t ops = work();
+		auto end = std::chrono::steady_clock::now();
+		double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		nsPerOp.push_back(ns / static_cast<double>(ops));
+	}
+	std::sort(nsPerOp.begin(), nsPerOp.end());
+	result.medianNs = nsPerOp[nsPerOp.size() / 2];
+	result.minNs = nsPerOp.front();
+	return result;
+}
+
+static void printResult(const BenchResult& result) {
+	std::cout << std::left << std::setw(28) << result.name
+	          << std::right << std::setw(10) << result.ops
+	          << std::fixed << std::setprecision(1)
+	          << std::setw(12) << result.medianNs
+	          << std::setw(12) << result.minNs
+	          << std::setprecision(2)
+	          << std::setw(12) << 1000.0 / result.medianNs
+	          << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	int runs = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 7;
+	std::string filter = (argc > 2) ? argv[2] : "";
+
+	std::vector<Board> boards;
+	std::vector<std::vector<std::string>> legalMoves;
+	for (const std::string& fen : BENCH_FENS) {
+		Board board;
+		if (!board.loadFen(fen)) {
+			std::cout << "bad bench fen: " << fen << std::endl;
+			return 1;
+		}
+		legalMoves.push_back(generateLegalMoves(board));
+		boards.push_back(board);
+	}
+
+	// Each benchmark repeats its inner loop enough times to take a few milliseconds.
+	std::vector<std::pair<std::string, std::function<uint64_t()>>> benches = {
+		{"pushMove+popMove", [&]() {
+			uint64_t ops = 0;
+			for (int rep = 0; rep < 200; rep++) {
+				for (size_t i = 0; i < boards.size(); i++) {
+					for (const std::string& move : legalMoves[i]) {
+						boards[i].pushMove(move);
+						boards[i].popMove(move);
+						ops++;
+					}
+				}
+			}
+			return ops;
+		}},
+		{"generatePseudoLegalMoves", [&]() {
+			uint64_t ops = 0, moves = 0;
+			for (int rep = 0; rep < 200; rep++) {
+				for (Board& board : boards) {
+					moves += generatePseudoLegalMoves(board).size();
+					ops++;
+				}
+			}
+			benchSink = benchSink + moves;
+			return ops;
+		}},
+		{"generateLegalMoves", [&]() {
+			uint64_t ops = 0, moves = 0;
+			for (int rep = 0; rep < 50; rep++) {
+				for (Board& board : boards) {
+					moves += generateLegalMoves(board).size();
+					ops++;
+				}
+			}
+			benchSink = benchSink + moves;
+			return ops;
+		}},
+		{"isSquareAttacked", [&]() {
+			uint64_t ops = 0, attacked = 0;
+			for (int rep = 0; rep < 100; rep++) {
+				for (Board& board : boards) {
+					for (int r = 2; r < BOARD_ROWS - 2; r++) {
+						for (int c = 1; c < BOARD_COLS - 1; c++) {
+							attacked += board.isSquareAttacked(r, c, PieceColor::WHITE);
+							attacked += board.isSquareAttacked(r, c, PieceColor::BLACK);
+							ops += 2;
+						}
+					}
+				}
+			}
+			benchSink = benchSink + attacked;
+			return ops;
+		}},
+		{"isInCheck", [&]() {
+			uint64_t ops = 0, checks = 0;
+			for (int rep = 0; rep < 2000; rep++) {
+				for (Board& board : boards) {
+					checks += board.isInCheck(PieceColor::WHITE);
+					checks += board.isInCheck(PieceColor::BLACK);
+					ops += 2;
+				}
+			}
+			benchSink = benchSink + checks;
+			return ops;
+		}},
+		{"evaluatePosition", [&]() {
+			uint64_t ops = 0;
+			double total = 0;
+			for (int rep = 0; rep < 2000; rep++) {
+				for (Board& board : boards) {
+					total += evaluatePosition(board);
+					ops++;
+				}
+			}
+			benchSink = benchSink + static_cast<uint64_t>(total);
+			return ops;
+		}},
+	};
+
+	std::cout << BENCH_FENS.size() << " positions, " << runs << " runs per benchmark" << std::endl;
+	std::cout << std::left << std::setw(28) << "benchmark"
+	          << std::right << std::setw(10) << "ops/run"
+	          << std::setw(12) << "ns/op"
+	          << std::setw(12) << "min ns/op"
+	          << std::setw(12) << "Mops/s" << std::endl;
+	for (const auto& bench : benches) {
+		if (!filter.empty() && bench.first.find(filter) == std::string::npos) {
+			continue;
+		}
+		printResult(runBench(bench.first, runs, bench.second));
+	}
+	return 0;
+}
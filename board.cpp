@@ -1,18 +1,134 @@
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
 #include "board.h"
 #include "piece.h"
+#include "profile.h"
 
 const Piece EMPTY_PIECE(PieceType::EMPTY, PieceColor::NONE);
 
+// --- Zobrist hashing ---
+// Square index 0..63 is a8..h1, i.e. (row - 2) * 8 + (col - 1).
+
+static int squareIndex(int row, int col) {
+    return (row - 2) * 8 + (col - 1);
+}
+
+// 0..11: white pawn..king, then black pawn..king. -1 for an empty square.
+static int zobristPieceIndex(const Piece& piece) {
+    if (piece.getType() == PieceType::EMPTY) {
+        return -1;
+    }
+    return static_cast<int>(piece.getType()) - 1 + (piece.getColor() == PieceColor::BLACK ? 6 : 0);
+}
+
+struct ZobristKeys {
+    uint64_t pieces[12][64];
+    uint64_t castling[4]; // white kingside, white queenside, black kingside, black queenside
+    uint64_t enPassantFile[8];
+    uint64_t blackToMove;
+
+    ZobristKeys() {
+        // Fixed seed so keys are the same on every run (and in every instance)
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        auto next = [&seed]() {
+            // splitmix64
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        };
+        for (auto& piece : pieces) {
+            for (auto& square : piece) {
+                square = next();
+            }
+        }
+        for (auto& castle : castling) castle = next();
+        for (auto& file : enPassantFile) file = next();
+        blackToMove = next();
+    }
+};
+
+static const ZobristKeys ZOBRIST;
+
+// --- Cuckoo tables for upcoming repetition detection ---
+// Every reversible move of a non-pawn piece (a move that can be undone by moving the piece
+// back) changes the key by pieces[pc][s1] ^ pieces[pc][s2] ^ blackToMove. The tables store
+// all 3668 of these keys, so a key difference between the current position and one an odd
+// number of plies back can be looked up to see whether one move could get back there.
+// See "Efficient detection of repetitions" (Marcel van Kervinck) as used in Stockfish.
+
+struct CuckooTables {
+    static const int SIZE = 8192;
+    uint64_t keys[SIZE];
+    int pieceIndex[SIZE];
+    int from[SIZE];
+    int to[SIZE];
+
+    static int h1(uint64_t key) { return static_cast<int>(key & 0x1FFF); }
+    static int h2(uint64_t key) { return static_cast<int>((key >> 16) & 0x1FFF); }
+
+    CuckooTables() {
+        for (int i = 0; i < SIZE; i++) {
+            keys[i] = 0;
+            pieceIndex[i] = -1;
+            from[i] = to[i] = 0;
+        }
+        for (int pc = 0; pc < 12; pc++) {
+            PieceType type = static_cast<PieceType>(pc % 6 + 1);
+            if (type == PieceType::PAWN) {
+                continue;
+            }
+            for (int s1 = 0; s1 < 64; s1++) {
+                for (int s2 = s1 + 1; s2 < 64; s2++) {
+                    if (!pieceMoves(type, s1, s2)) {
+                        continue;
+                    }
+                    uint64_t key = ZOBRIST.pieces[pc][s1] ^ ZOBRIST.pieces[pc][s2] ^ ZOBRIST.blackToMove;
+                    int piece = pc, a = s1, b = s2;
+                    int slot = h1(key);
+                    // Cuckoo insertion: kick out whatever is in the slot and move it to its other slot
+                    while (true) {
+                        std::swap(keys[slot], key);
+                        std::swap(pieceIndex[slot], piece);
+                        std::swap(from[slot], a);
+                        std::swap(to[slot], b);
+                        if (piece == -1) {
+                            break;
+                        }
+                        slot = (slot == h1(key)) ? h2(key) : h1(key);
+                    }
+                }
+            }
+        }
+    }
+
+    // Can a piece of this type go from s1 to s2 on an empty board?
+    static bool pieceMoves(PieceType type, int s1, int s2) {
+        int dr = abs(s1 / 8 - s2 / 8);
+        int dc = abs(s1 % 8 - s2 % 8);
+        switch (type) {
+            case PieceType::KNIGHT: return (dr == 1 && dc == 2) || (dr == 2 && dc == 1);
+            case PieceType::BISHOP: return dr == dc;
+            case PieceType::ROOK:   return dr == 0 || dc == 0;
+            case PieceType::QUEEN:  return dr == dc || dr == 0 || dc == 0;
+            case PieceType::KING:   return dr <= 1 && dc <= 1;
+            default:                return false;
+        }
+    }
+};
+
+static const CuckooTables CUCKOO;
+
 Board::Board() {
 	moveCount = 0;
 	enPassantTargetSquare = {-1, -1};
-    wtime = 0;
-    btime = 0;
-    winc = 0;
-    binc = 0;
+	halfmoveClock = 0;
+	pliesFromNull = 0;
 	
     for (int r = 0; r < BOARD_ROWS; ++r) {
         for (int c = 0; c < BOARD_COLS; ++c) {
@@ -50,6 +166,7 @@ Board::Board() {
 	whiteQueensideCastle = true;
 	blackKingsideCastle = true;
 	blackQueensideCastle = true;
+	key = computeKey();
 }
 
 // Gets the piece at a given 0-indexed row and column.
@@ -64,6 +181,10 @@ Piece Board::getPieceAt(int row, int col) const {
 // Sets a piece at a given 0-indexed row and column.
 void Board::setPieceAt(int row, int col, const Piece& piece) {
     if (row >= 2 && row < BOARD_ROWS-2 && col >= 1 && col < BOARD_COLS-1) {
+        int oldIndex = zobristPieceIndex(squares[row][col]);
+        int newIndex = zobristPieceIndex(piece);
+        if (oldIndex >= 0) key ^= ZOBRIST.pieces[oldIndex][squareIndex(row, col)];
+        if (newIndex >= 0) key ^= ZOBRIST.pieces[newIndex][squareIndex(row, col)];
         squares[row][col] = piece;
     }
     // Else, you might want to log an error or throw an exception if out of bounds.
@@ -101,21 +222,6 @@ void Board::printBoard() {
     std::cout << std::endl;
 }
 
-void Board::setWTime(int WTime) {
-	this->wtime = WTime;
-}
-
-void Board::setBTime(int BTime) {
-	this->btime = BTime;
-}
-
-void Board::setWInc(int WInc) {
-	this->winc = WInc;
-}
-void Board::setBInc(int BInc) {
-	this->binc = BInc;
-}
-
 std::pair<int, int> Board::convertUciToCoords(const std::string& uciSquare) const {
     if (uciSquare.length() < 2) {
         return {-1, -1}; // Invalid input
@@ -129,6 +235,7 @@ std::pair<int, int> Board::convertUciToCoords(const std::string& uciSquare) cons
 
 // In board.cpp
 void Board::pushMove(const std::string& move) {
+    BEARBOT_PROFILE_SCOPE(PROFILE_PUSH_MOVE);
     if (move.length() < 4) return;
 
     // --- Checkpoint A ---
@@ -138,6 +245,10 @@ void Board::pushMove(const std::string& move) {
     currentState.whiteQueensideCastle = this->whiteQueensideCastle;
     currentState.blackKingsideCastle = this->blackKingsideCastle;
     currentState.blackQueensideCastle = this->blackQueensideCastle;
+    currentState.key = this->key;
+    currentState.halfmoveClock = this->halfmoveClock;
+    currentState.pliesFromNull = this->pliesFromNull;
+    key ^= stateKey(); // castling, en passant and side to move are added back at the end
 
     // --- Checkpoint B ---
     std::pair<int, int> from = convertUciToCoords(move.substr(0, 2));
@@ -151,6 +262,9 @@ void Board::pushMove(const std::string& move) {
     Piece pieceToMove = getPieceAt(fromRow, fromCol);
     Piece capturedPiece = getPieceAt(toRow, toCol);
     enPassantTargetSquare = {-1, -1};
+    bool irreversible = pieceToMove.getType() == PieceType::PAWN || capturedPiece.getType() != PieceType::EMPTY;
+    halfmoveClock = irreversible ? 0 : halfmoveClock + 1;
+    pliesFromNull++;
 
     // --- Checkpoint D ---
     if (pieceToMove.getType() == PieceType::PAWN) {
@@ -199,9 +313,11 @@ void Board::pushMove(const std::string& move) {
     }
 
     moveCount++;
+    key ^= stateKey();
 }
 
 void Board::popMove(const std::string& move) {
+    BEARBOT_PROFILE_SCOPE(PROFILE_POP_MOVE);
     if (history.empty()) {
         return; // Safety check
     }
@@ -268,12 +384,126 @@ void Board::popMove(const std::string& move) {
 
     // 8. Decrement the move count to fully restore the state
     moveCount--;
+
+    // 9. setPieceAt has been updating the key along the way, but the saved one is exact
+    this->key = lastState.key;
+    this->halfmoveClock = lastState.halfmoveClock;
+    this->pliesFromNull = lastState.pliesFromNull;
+}
+
+// Passes the turn without moving a piece (used by null move pruning in the search).
+void Board::pushNullMove() {
+    BoardState currentState;
+    currentState.enPassantTargetSquare = this->enPassantTargetSquare;
+    currentState.whiteKingsideCastle = this->whiteKingsideCastle;
+    currentState.whiteQueensideCastle = this->whiteQueensideCastle;
+    currentState.blackKingsideCastle = this->blackKingsideCastle;
+    currentState.blackQueensideCastle = this->blackQueensideCastle;
+    currentState.key = this->key;
+    currentState.halfmoveClock = this->halfmoveClock;
+    currentState.pliesFromNull = this->pliesFromNull;
+    history.push_back(currentState);
+
+    key ^= stateKey();
+    enPassantTargetSquare = {-1, -1};
+    moveCount++;
+    halfmoveClock++;
+    pliesFromNull = 0;
+    key ^= stateKey();
+}
+
+void Board::popNullMove() {
+    if (history.empty()) {
+        return;
+    }
+    BoardState lastState = history.back();
+    history.pop_back();
+    this->enPassantTargetSquare = lastState.enPassantTargetSquare;
+    this->key = lastState.key;
+    this->halfmoveClock = lastState.halfmoveClock;
+    this->pliesFromNull = lastState.pliesFromNull;
+    moveCount--;
 }
 
 void Board::initializeBoard() {
 	*this = Board();
 }
 
+// Sets the board up from a FEN string, e.g.
+// "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+// Returns false (and leaves the board at the start position) if the FEN can't be parsed.
+bool Board::loadFen(const std::string& fen) {
+	initializeBoard();
+	std::stringstream ss(fen);
+	std::string placement, side, castling, enPassant;
+	int halfmove = 0;
+	int fullmove = 1;
+	if (!(ss >> placement >> side)) {
+		return false;
+	}
+	if (!(ss >> castling)) castling = "-";
+	if (!(ss >> enPassant)) enPassant = "-";
+	if (!(ss >> halfmove >> fullmove)) { halfmove = 0; fullmove = 1; }
+
+	Board fenBoard;
+	for (int r = 0; r < BOARD_ROWS; ++r) {
+		for (int c = 0; c < BOARD_COLS; ++c) {
+			fenBoard.squares[r][c] = EMPTY_PIECE;
+		}
+	}
+
+	// Piece placement, rank 8 (array row 2) down to rank 1 (array row 9)
+	int row = 2;
+	int col = 1;
+	for (char ch : placement) {
+		if (ch == '/') {
+			row++;
+			col = 1;
+			continue;
+		}
+		if (ch >= '1' && ch <= '8') {
+			col += ch - '0';
+			continue;
+		}
+		PieceColor color = isupper(static_cast<unsigned char>(ch)) ? PieceColor::WHITE : PieceColor::BLACK;
+		PieceType type;
+		switch (tolower(static_cast<unsigned char>(ch))) {
+			case 'p': type = PieceType::PAWN;   break;
+			case 'n': type = PieceType::KNIGHT; break;
+			case 'b': type = PieceType::BISHOP; break;
+			case 'r': type = PieceType::ROOK;   break;
+			case 'q': type = PieceType::QUEEN;  break;
+			case 'k': type = PieceType::KING;   break;
+			default: return false;
+		}
+		if (row > 9 || col > 8) {
+			return false;
+		}
+		fenBoard.squares[row][col] = Piece(type, color);
+		col++;
+	}
+	if (row != 9) {
+		return false;
+	}
+
+	fenBoard.whiteKingsideCastle = castling.find('K') != std::string::npos;
+	fenBoard.whiteQueensideCastle = castling.find('Q') != std::string::npos;
+	fenBoard.blackKingsideCastle = castling.find('k') != std::string::npos;
+	fenBoard.blackQueensideCastle = castling.find('q') != std::string::npos;
+
+	if (enPassant != "-") {
+		fenBoard.enPassantTargetSquare = convertUciToCoords(enPassant);
+	}
+
+	// The side to move is derived from the parity of moveCount
+	fenBoard.moveCount = 2 * (fullmove > 0 ? fullmove - 1 : 0) + (side == "b" ? 1 : 0);
+	fenBoard.halfmoveClock = halfmove;
+	fenBoard.key = fenBoard.computeKey();
+
+	*this = fenBoard;
+	return true;
+}
+
 PieceColor Board::getCurrentPlayer() const {
 	if (moveCount % 2 == 0) {
 		return PieceColor::WHITE;
@@ -303,6 +533,7 @@ std::pair<int, int> Board::findKing(PieceColor kingColor) const {
 // ✅ NEW IMPLEMENTATION: isSquareAttacked
 // Checks if a square at (r, c) is being attacked by a piece of 'attackerColor'.
 bool Board::isSquareAttacked(int r, int c, PieceColor attackerColor) const {
+    BEARBOT_PROFILE_SCOPE(PROFILE_SQUARE_ATTACKED);
     // 1. Check for Pawn attacks
     int pawnDir = (attackerColor == PieceColor::WHITE) ? 1 : -1;
     if (getPieceAt(r + pawnDir, c - 1).getType() == PieceType::PAWN && getPieceAt(r + pawnDir, c - 1).getColor() == attackerColor) return true;
@@ -376,3 +607,121 @@ bool Board::isInCheck(PieceColor color) const {
     // Return true if the king's square is attacked by the opponent.
     return isSquareAttacked(kingPos.first, kingPos.second, opponentColor);
 }
+
+uint64_t Board::getKey() const {
+    return key;
+}
+
+int Board::getHalfmoveClock() const {
+    return halfmoveClock;
+}
+
+int Board::getFullmoveNumber() const {
+    return moveCount / 2 + 1;
+}
+
+// Neither side can mate: K v K, K+N v K, K+B v K.
+bool Board::hasInsufficientMaterial() const {
+    int minors = 0;
+    for (int r = 2; r < BOARD_ROWS - 2; ++r) {
+        for (int c = 1; c < BOARD_COLS - 1; ++c) {
+            PieceType type = squares[r][c].getType();
+            if (type == PieceType::PAWN || type == PieceType::ROOK || type == PieceType::QUEEN) {
+                return false;
+            }
+            if (type == PieceType::KNIGHT || type == PieceType::BISHOP) {
+                minors++;
+            }
+        }
+    }
+    return minors <= 1;
+}
+
+// The part of the key that isn't piece placement: castling rights, en passant file and side to move.
+uint64_t Board::stateKey() const {
+    uint64_t k = 0;
+    if (whiteKingsideCastle) k ^= ZOBRIST.castling[0];
+    if (whiteQueensideCastle) k ^= ZOBRIST.castling[1];
+    if (blackKingsideCastle) k ^= ZOBRIST.castling[2];
+    if (blackQueensideCastle) k ^= ZOBRIST.castling[3];
+    if (enPassantTargetSquare.first != -1) k ^= ZOBRIST.enPassantFile[enPassantTargetSquare.second - 1];
+    if (getCurrentPlayer() == PieceColor::BLACK) k ^= ZOBRIST.blackToMove;
+    return k;
+}
+
+// Builds the key from scratch. Only needed when a position is set up, pushMove keeps it up to date.
+uint64_t Board::computeKey() const {
+    uint64_t k = stateKey();
+    for (int r = 2; r < BOARD_ROWS - 2; ++r) {
+        for (int c = 1; c < BOARD_COLS - 1; ++c) {
+            int index = zobristPieceIndex(squares[r][c]);
+            if (index >= 0) {
+                k ^= ZOBRIST.pieces[index][squareIndex(r, c)];
+            }
+        }
+    }
+    return k;
+}
+
+// True if the current position is a draw by repetition as far as the search is concerned.
+// ply is the distance from the search root: repeating a position inside the search tree
+// is enough, one from before the root has to have occurred twice (threefold repetition).
+// Only positions back to the last capture, pawn move or null move can repeat, so
+// that's as far back as the history is scanned.
+bool Board::isRepetition(int ply) const {
+    int end = std::min(halfmoveClock, pliesFromNull);
+    int size = static_cast<int>(history.size());
+    bool seenBeforeRoot = false;
+    for (int i = 4; i <= end && i <= size; i += 2) {
+        if (history[size - i].key == key) {
+            if (i < ply || seenBeforeRoot) {
+                return true;
+            }
+            seenBeforeRoot = true;
+        }
+    }
+    return false;
+}
+
+// True if the side to move has a move that repeats a position from earlier in the search
+// (i.e. it can force a draw by repetition). ply is the distance from the search root; a
+// repetition of a position from before the root is not enough to call the line a draw.
+bool Board::hasUpcomingRepetition(int ply) const {
+    int end = std::min(halfmoveClock, pliesFromNull);
+    int size = static_cast<int>(history.size());
+    if (end < 3) {
+        return false;
+    }
+    for (int i = 3; i <= end && i <= size; i += 2) {
+        uint64_t moveKey = key ^ history[size - i].key;
+        int slot = CuckooTables::h1(moveKey);
+        if (CUCKOO.keys[slot] != moveKey) {
+            slot = CuckooTables::h2(moveKey);
+            if (CUCKOO.keys[slot] != moveKey) {
+                continue;
+            }
+        }
+
+        // The move is only playable if nothing stands between its two squares.
+        int s1 = CUCKOO.from[slot];
+        int s2 = CUCKOO.to[slot];
+        int dr = (s2 / 8 > s1 / 8) ? 1 : (s2 / 8 < s1 / 8 ? -1 : 0);
+        int dc = (s2 % 8 > s1 % 8) ? 1 : (s2 % 8 < s1 % 8 ? -1 : 0);
+        bool pathClear = true;
+        if (CUCKOO.pieceIndex[slot] % 6 != static_cast<int>(PieceType::KNIGHT) - 1) {
+            int r = s1 / 8 + dr, c = s1 % 8 + dc;
+            while (r * 8 + c != s2) {
+                if (squares[r + 2][c + 1].getType() != PieceType::EMPTY) {
+                    pathClear = false;
+                    break;
+                }
+                r += dr;
+                c += dc;
+            }
+        }
+        if (pathClear && ply > i) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <cstdint>
 
 const int BOARD_ROWS = 12;
 const int BOARD_COLS = 10;
@@ -16,6 +17,9 @@ struct BoardState {
     bool whiteQueensideCastle = false;
     bool blackKingsideCastle = false;
     bool blackQueensideCastle = false;
+    uint64_t key = 0;       // Zobrist key of the position before the move
+    int halfmoveClock = 0;  // plies since the last capture or pawn move, before the move
+    int pliesFromNull = 0;
 };
 
 class Board {
@@ -31,19 +35,24 @@ public:
     Piece getPieceAt(int row, int col) const;
     void setPieceAt(int row, int col, const Piece& piece);
     void printBoard();
-	void setWTime(int WTime);
-	void setBTime(int BTime);
-	void setWInc(int WInc);
-	void setBInc(int BInc);
     std::pair<int, int> convertUciToCoords(const std::string& uciSquare) const;
 	void pushMove(const std::string& move);
 	void popMove(const std::string& move);
+	void pushNullMove();
+	void popNullMove();
 	void initializeBoard();
+	bool loadFen(const std::string& fen);
 	PieceColor getCurrentPlayer() const;
 	std::pair<int, int> getEnPassantTarget() const;
 	std::pair<int, int> findKing(PieceColor kingColor) const;
 	bool isSquareAttacked(int r, int c, PieceColor attackerColor) const;
 	bool isInCheck(PieceColor color) const;
+	uint64_t getKey() const;
+	int getHalfmoveClock() const;
+	int getFullmoveNumber() const;
+	bool hasInsufficientMaterial() const;
+	bool isRepetition(int ply) const;
+	bool hasUpcomingRepetition(int ply) const;
     // void makeMove(const std::string& move);
     // bool isMoveLegal(...);
 
@@ -52,11 +61,12 @@ private:
     int moveCount;
     std::pair<int, int> enPassantTargetSquare;
     std::vector<BoardState> history;
-    
-    int wtime; // White's remaining time in milliseconds
-    int btime; // Black's remaining time in milliseconds
-    int winc;  // White's increment in milliseconds
-    int binc;  // Black's increment in milliseconds
+    uint64_t key;       // Zobrist key, kept up to date by setPieceAt and pushMove
+    int halfmoveClock;  // plies since the last capture or pawn move (fifty move rule)
+    int pliesFromNull;  // plies since the last null move, repetitions can't cross one
+
+    uint64_t computeKey() const;
+    uint64_t stateKey() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef BOOK_H_
+#define BOOK_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "board.h"
+
+// Polyglot opening books.
+//
+// A book is a file of 16 byte entries, all big-endian, sorted by key:
+//
+//   bytes  0-7   position key
+//   bytes  8-9   move: bits 0-2 to file, 3-5 to rank, 6-8 from file, 9-11 from rank,
+//                12-14 promotion (0 none, 1 knight, 2 bishop, 3 rook, 4 queen).
+//                Castling is written as the king taking its own rook (e1h1, e1a1, e8h8, e8a8).
+//   bytes 10-11  weight, readers pick moves in proportion to it
+//   bytes 12-15  learn (always 0 here)
+//
+// The key is an XOR of 781 random numbers: one per (piece, square), four castling rights,
+// eight en passant files (only counted when a pawn of the side to move can really take en
+// passant) and one for white to move. The numbers are Polyglot's fixed Random64 table, so
+// the books work with any Polyglot reader (the start position's key is 463b96181691fc9c).
+// --keys replaces the table with another one: 781 big-endian 64 bit numbers in Polyglot's
+// order (6248 bytes).
+const size_t POLYGLOT_ENTRY_BYTES = 16;
+const int POLYGLOT_RANDOM_COUNT = 781;
+
+struct PolyglotEntry {
+	uint64_t key = 0;
+	uint16_t move = 0;
+	uint16_t weight = 0;
+	uint32_t learn = 0;
+};
+
+struct PolyglotKeys {
+	uint64_t random[POLYGLOT_RANDOM_COUNT];
+
+	PolyglotKeys();                         // Polyglot's Random64
+	bool load(const std::string& path);     // another table, see above
+
+	uint64_t key(const Board& board) const;
+};
+
+// Book move of a legal UCI move on this board (castling becomes king takes rook).
+uint16_t polyglotMove(const Board& board, const std::string& uciMove);
+// And back, checked against the legal moves. Empty if the book move isn't legal here.
+std::string polyglotMoveToUci(Board& board, uint16_t move);
+
+void writePolyglotEntry(const PolyglotEntry& entry, unsigned char* bytes);
+PolyglotEntry readPolyglotEntry(const unsigned char* bytes);
+
+// "bearbot book <games.pgn> [more.pgn ...] --output book.bin [options]" compiles PGN games
+// into a Polyglot book.
+//
+//   --output FILE       the book (required)
+//   --max-ply N         only positions from the first N plies of every game (default 32)
+//   --min-games N       leave out moves played in fewer games (default 1)
+//   --threads N         default: all cores
+//   --keys FILE         a key table other than Polyglot's (see above)
+//
+// The PGN files are memory-mapped and cut into chunks at "[Event" tags, the threads take
+// chunks one at a time and tokenize them in place. A SAN move is resolved by looking
+// from its target square for the pieces that can get there, then checking the move is
+// legal; plies past --max-ply are only tokenized. Every thread keeps a list of (key, move, games, points)
+// records that it sorts and merges whenever it grows, the sorted lists of all threads are
+// merged straight into the book at the end. A move's weight is 2 per win plus 1 per draw
+// (games without a result count as draws) for the side that played it.
+//
+// "bearbot book probe <book.bin> [fen] [--keys FILE]" lists the book moves of a position
+// (default: the start position).
+int runBook(const std::vector<std::string>& args);
+
+#endif
@@ -0,0 +1,140 @@
+#include <string>
+#include <cstdint>
+
+#include "cpu.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BEARBOT_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define BEARBOT_X86 1
+#endif
+
+#ifndef BEARBOT_ARCH_NAME
+#define BEARBOT_ARCH_NAME "generic"
+#endif
+
+#ifdef BEARBOT_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuidex(info, leaf, subleaf);
+	for (int i = 0; i < 4; i++) regs[i] = static_cast<unsigned int>(info[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// AVX2 also needs the OS to save the ymm registers on a context switch.
+static bool osSavesYmm() {
+#ifdef _MSC_VER
+	return (_xgetbv(0) & 0x6) == 0x6;
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (eax & 0x6) == 0x6;
+#endif
+}
+#endif
+
+static CpuFeatures detectCpuFeatures() {
+	CpuFeatures features;
+#ifdef BEARBOT_X86
+	unsigned int regs[4] = {0, 0, 0, 0};
+	cpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf >= 1) {
+		cpuid(1, 0, regs);
+		features.sse42 = (regs[2] >> 20) & 1;
+		features.popcnt = (regs[2] >> 23) & 1;
+		bool osxsave = (regs[2] >> 27) & 1;
+		bool avx = (regs[2] >> 28) & 1;
+		if (maxLeaf >= 7) {
+			cpuid(7, 0, regs);
+			features.bmi2 = (regs[1] >> 8) & 1;
+			features.avx2 = ((regs[1] >> 5) & 1) && avx && osxsave && osSavesYmm();
+		}
+	}
+#endif
+	return features;
+}
+
+const CpuFeatures& cpuFeatures() {
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
+
+std::string cpuFeatureString(const CpuFeatures& features) {
+	std::string names;
+	if (features.sse42) names += " sse4.2";
+	if (features.popcnt) names += " popcnt";
+	if (features.bmi2) names += " bmi2";
+	if (features.avx2) names += " avx2";
+	return names.empty() ? "none" : names.substr(1);
+}
+
+const char* compiledArchName() {
+	return BEARBOT_ARCH_NAME;
+}
+
+bool cpuSupportsBuild(std::string& missing) {
+	CpuFeatures required;
+#if defined(__SSE4_2__)
+	required.sse42 = true;
+#endif
+#if defined(__POPCNT__)
+	required.popcnt = true;
+#endif
+#if defined(__BMI2__)
+	required.bmi2 = true;
+#endif
+#if defined(__AVX2__)
+	required.avx2 = true;
+#endif
+	const CpuFeatures& have = cpuFeatures();
+	CpuFeatures lacking;
+	lacking.sse42 = required.sse42 && !have.sse42;
+	lacking.popcnt = required.popcnt && !have.popcnt;
+	lacking.bmi2 = required.bmi2 && !have.bmi2;
+	lacking.avx2 = required.avx2 && !have.avx2;
+	missing = cpuFeatureString(lacking);
+	return missing == "none";
+}
+
+// --- popcount ---
+
+static int popCount64Generic(uint64_t bits) {
+	bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+	bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+	bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return static_cast<int>((bits * 0x0101010101010101ULL) >> 56);
+}
+
+#if defined(BEARBOT_X86) && defined(_MSC_VER) && defined(_M_X64)
+static int popCount64Hardware(uint64_t bits) {
+	return static_cast<int>(__popcnt64(bits));
+}
+#elif defined(BEARBOT_X86) && defined(__x86_64__)
+__attribute__((target("popcnt")))
+static int popCount64Hardware(uint64_t bits) {
+	return __builtin_popcountll(bits);
+}
+#else
+#define BEARBOT_NO_HW_POPCNT 1
+#endif
+
+static int (*selectPopCount64())(uint64_t) {
+#ifndef BEARBOT_NO_HW_POPCNT
+	if (cpuFeatures().popcnt) {
+		return popCount64Hardware;
+	}
+#endif
+	return popCount64Generic;
+}
+
+int (*popCount64)(uint64_t bits) = selectPopCount64();
+
+const char* popCount64KernelName() {
+	return popCount64 == popCount64Generic ? "generic" : "popcnt";
+}
@@ -0,0 +1,30 @@
+#ifndef CPU_H_
+#define CPU_H_
+
+#include <cstdint>
+#include <string>
+
+// Instruction set extensions we can make use of, detected at runtime with cpuid.
+struct CpuFeatures {
+	bool sse42 = false;
+	bool popcnt = false;
+	bool bmi2 = false;
+	bool avx2 = false;
+};
+
+const CpuFeatures& cpuFeatures();
+std::string cpuFeatureString(const CpuFeatures& features);
+
+// The ISA level this binary was compiled for (set by the build, see CMakeLists.txt).
+const char* compiledArchName();
+// False if the binary was compiled for instructions this CPU doesn't have.
+// missing is set to the names of the missing extensions.
+bool cpuSupportsBuild(std::string& missing);
+
+// Kernels pointed at the best implementation for this CPU the first time cpu.cpp is initialized.
+// The board is a mailbox, not bitboards, so there is little to dispatch: popCount64's only
+// caller is the occupancy count of packed datagen positions.
+extern int (*popCount64)(uint64_t bits);
+const char* popCount64KernelName();
+
+#endif
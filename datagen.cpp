@@ -0,0 +1,352 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+
+#include "datagen.h"
+#include "board.h"
+#include "engine.h"
+#include "search.h"
+#include "cpu.h"
+#include "numa.h"
+
+static const size_t DATAGEN_BATCH = 16384;  // positions a thread collects before writing
+static const int DATAGEN_MAX_PLIES = 400;
+static const int ADJUDICATE_SCORE = 2000;   // a side this far ahead for ADJUDICATE_PLIES plies has won
+static const int ADJUDICATE_PLIES = 6;
+
+static const char PIECE_CHARS[] = "PNBRQKpnbrqk";
+
+// Same order as the Zobrist piece index: white pawn..king, then black pawn..king.
+static int pieceCode(const Piece& piece) {
+	return static_cast<int>(piece.getType()) - 1 + (piece.getColor() == PieceColor::BLACK ? 6 : 0);
+}
+
+PackedPosition packPosition(const Board& board, int whiteScore) {
+	PackedPosition position;
+	int count = 0;
+	for (int sq = 0; sq < 64; sq++) {
+		Piece piece = board.getPieceAt(sq / 8 + 2, sq % 8 + 1);
+		if (piece.getType() == PieceType::EMPTY) {
+			continue;
+		}
+		position.occupancy |= 1ULL << sq;
+		int code = pieceCode(piece);
+		position.pieces[count / 2] |= static_cast<uint8_t>((count % 2 == 0) ? code : code << 4);
+		count++;
+	}
+	position.flags = (board.getCurrentPlayer() == PieceColor::BLACK ? 1 : 0)
+	               | (board.whiteKingsideCastle ? 2 : 0) | (board.whiteQueensideCastle ? 4 : 0)
+	               | (board.blackKingsideCastle ? 8 : 0) | (board.blackQueensideCastle ? 16 : 0);
+	std::pair<int, int> enPassant = board.getEnPassantTarget();
+	position.enPassantFile = static_cast<uint8_t>(enPassant.first == -1 ? 8 : enPassant.second - 1);
+	position.halfmoveClock = static_cast<uint8_t>(std::min(board.getHalfmoveClock(), 255));
+	position.score = static_cast<int16_t>(std::max(-32000, std::min(32000, whiteScore)));
+	position.fullmove = static_cast<uint16_t>(std::min(board.getFullmoveNumber(), 65535));
+	return position;
+}
+
+std::string packedToFen(const PackedPosition& position) {
+	std::string fen;
+	int count = 0;
+	for (int row = 0; row < 8; row++) {
+		int empty = 0;
+		for (int col = 0; col < 8; col++) {
+			int sq = row * 8 + col;
+			if (!(position.occupancy & (1ULL << sq))) {
+				empty++;
+				continue;
+			}
+			if (empty > 0) {
+				fen += static_cast<char>('0' + empty);
+				empty = 0;
+			}
+			int code = (count % 2 == 0) ? position.pieces[count / 2] & 0xF : position.pieces[count / 2] >> 4;
+			fen += PIECE_CHARS[code];
+			count++;
+		}
+		if (empty > 0) {
+			fen += static_cast<char>('0' + empty);
+		}
+		if (row < 7) {
+			fen += '/';
+		}
+	}
+
+	fen += (position.flags & 1) ? " b " : " w ";
+	std::string castling;
+	if (position.flags & 2) castling += 'K';
+	if (position.flags & 4) castling += 'Q';
+	if (position.flags & 8) castling += 'k';
+	if (position.flags & 16) castling += 'q';
+	fen += castling.empty() ? "-" : castling;
+	if (position.enPassantFile < 8) {
+		fen += ' ';
+		fen += static_cast<char>('a' + position.enPassantFile);
+		fen += (position.flags & 1) ? '3' : '6';
+	} else {
+		fen += " -";
+	}
+	fen += " " + std::to_string(position.halfmoveClock) + " " + std::to_string(position.fullmove);
+	return fen;
+}
+
+void writePackedPosition(const PackedPosition& position, unsigned char* bytes) {
+	for (int i = 0; i < 8; i++) bytes[i] = static_cast<unsigned char>(position.occupancy >> (8 * i));
+	for (int i = 0; i < 16; i++) bytes[8 + i] = position.pieces[i];
+	bytes[24] = position.flags;
+	bytes[25] = position.enPassantFile;
+	bytes[26] = position.halfmoveClock;
+	bytes[27] = position.result;
+	uint16_t score = static_cast<uint16_t>(position.score);
+	bytes[28] = static_cast<unsigned char>(score);
+	bytes[29] = static_cast<unsigned char>(score >> 8);
+	bytes[30] = static_cast<unsigned char>(position.fullmove);
+	bytes[31] = static_cast<unsigned char>(position.fullmove >> 8);
+}
+
+bool readPackedPosition(const unsigned char* bytes, PackedPosition& position) {
+	position.occupancy = 0;
+	for (int i = 0; i < 8; i++) position.occupancy |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+	for (int i = 0; i < 16; i++) position.pieces[i] = bytes[8 + i];
+	position.flags = bytes[24];
+	position.enPassantFile = bytes[25];
+	position.halfmoveClock = bytes[26];
+	position.result = bytes[27];
+	position.score = static_cast<int16_t>(bytes[28] | (bytes[29] << 8));
+	position.fullmove = static_cast<uint16_t>(bytes[30] | (bytes[31] << 8));
+
+	int count = popCount64(position.occupancy);
+	if (count < 2 || count > 32 || position.result > 2 || position.enPassantFile > 8) {
+		return false;
+	}
+	for (int i = 0; i < count; i++) {
+		int code = (i % 2 == 0) ? position.pieces[i / 2] & 0xF : position.pieces[i / 2] >> 4;
+		if (code >= 12) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int convertPackedFile(const std::string& inputPath, const std::string& outputPath) {
+	std::ifstream input(inputPath, std::ios::binary);
+	if (!input) {
+		std::cerr << "Can't open " << inputPath << std::endl;
+		return 1;
+	}
+	std::ofstream outputFile;
+	if (!outputPath.empty()) {
+		outputFile.open(outputPath);
+	}
+	std::ostream& output = outputPath.empty() ? std::cout : outputFile;
+
+	static const char* RESULTS[] = {"0.0", "0.5", "1.0"};
+	unsigned char bytes[PACKED_POSITION_BYTES];
+	uint64_t count = 0, bad = 0;
+	while (input.read(reinterpret_cast<char*>(bytes), PACKED_POSITION_BYTES)) {
+		PackedPosition position;
+		if (!readPackedPosition(bytes, position)) {
+			bad++;
+			continue;
+		}
+		output << packedToFen(position) << " | " << position.score << " | " << RESULTS[position.result] << '\n';
+		count++;
+	}
+	std::cerr << count << " positions converted";
+	if (bad > 0) {
+		std::cerr << ", " << bad << " invalid records skipped";
+	}
+	std::cerr << std::endl;
+	return 0;
+}
+
+// Writes batches of packed positions into one file. Every thread opens the file itself and
+// reserves the next free range with an atomic add, so no thread ever waits on another.
+class PackedWriter {
+public:
+	PackedWriter(const std::string& path, uint64_t maxPositions) : path(path), maxPositions(maxPositions), reserved(0) {}
+
+	// Writes as much of the batch as still fits. Returns false once the file is full.
+	bool write(std::fstream& file, const std::vector<PackedPosition>& batch) {
+		uint64_t start = reserved.load();
+		uint64_t count;
+		do {
+			if (start >= maxPositions) {
+				return false;
+			}
+			count = std::min<uint64_t>(batch.size(), maxPositions - start);
+		} while (!reserved.compare_exchange_weak(start, start + count));
+
+		std::vector<unsigned char> bytes(count * PACKED_POSITION_BYTES);
+		for (uint64_t i = 0; i < count; i++) {
+			writePackedPosition(batch[i], &bytes[i * PACKED_POSITION_BYTES]);
+		}
+		file.seekp(static_cast<std::streamoff>(start * PACKED_POSITION_BYTES));
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		file.flush();
+		return start + count < maxPositions;
+	}
+
+	bool full() const { return reserved.load() >= maxPositions; }
+	uint64_t remaining() const { return maxPositions - written(); }
+	uint64_t written() const { return std::min(reserved.load(), maxPositions); }
+
+	const std::string path;
+
+private:
+	const uint64_t maxPositions;
+	std::atomic<uint64_t> reserved;
+};
+
+// Plays self-play games until the writer is full.
+static void datagenWorker(int workerIndex, PackedWriter& writer, uint64_t seed, uint64_t nodes, int randomPlies) {
+	pinWorkerThread(workerIndex);
+	std::fstream file(writer.path, std::ios::in | std::ios::out | std::ios::binary);
+	std::mt19937_64 rng(seed);
+	SearchContext context;
+	context.limits.depth = MAX_PLY - 1;
+	context.limits.nodes = nodes;
+	context.reportInfo = false;
+
+	std::vector<PackedPosition> batch;
+	batch.reserve(DATAGEN_BATCH);
+	while (!writer.full()) {
+		// Randomized opening, so every game is different
+		Board board;
+		int plies = randomPlies + static_cast<int>(rng() % 2);
+		bool playable = true;
+		for (int i = 0; i < plies && playable; i++) {
+			std::vector<std::string> moves = generateLegalMoves(board);
+			if (moves.empty()) {
+				playable = false;
+			} else {
+				board.pushMove(moves[rng() % moves.size()]);
+			}
+		}
+		if (!playable) {
+			continue;
+		}
+
+		std::vector<PackedPosition> game;
+		std::vector<uint64_t> keys = {board.getKey()};
+		uint8_t result = 1;
+		int adjudicateStreak = 0;
+		for (int ply = 0; ply < DATAGEN_MAX_PLIES; ply++) {
+			PieceColor toMove = board.getCurrentPlayer();
+			bool inCheck = board.isInCheck(toMove);
+			std::vector<std::string> moves = generateLegalMoves(board);
+			if (moves.empty()) {
+				result = inCheck ? (toMove == PieceColor::WHITE ? 0 : 2) : 1;
+				break;
+			}
+			if (board.getHalfmoveClock() >= 100 || board.hasInsufficientMaterial()
+			    || std::count(keys.begin(), keys.end(), board.getKey()) >= 3) {
+				break;
+			}
+
+			SearchResult searchResult = search(board, context);
+			int whiteScore = (toMove == PieceColor::WHITE) ? searchResult.score : -searchResult.score;
+			if (std::abs(whiteScore) >= ADJUDICATE_SCORE) {
+				adjudicateStreak = (adjudicateStreak * whiteScore > 0) ? adjudicateStreak + (whiteScore > 0 ? 1 : -1) : (whiteScore > 0 ? 1 : -1);
+			} else {
+				adjudicateStreak = 0;
+			}
+			if (std::abs(adjudicateStreak) >= ADJUDICATE_PLIES) {
+				result = adjudicateStreak > 0 ? 2 : 0;
+				break;
+			}
+
+			// Quiet positions only: the static eval can't be trained on tactics.
+			bool mateScore = std::abs(searchResult.score) > MATE_SCORE - MAX_PLY;
+			if (!inCheck && !mateScore && !isCapture(board, searchResult.bestMove)) {
+				game.push_back(packPosition(board, whiteScore));
+			}
+			board.pushMove(searchResult.bestMove);
+			keys.push_back(board.getKey());
+		}
+
+		for (PackedPosition& position : game) {
+			position.result = result;
+			batch.push_back(position);
+		}
+		if (batch.size() >= std::min<uint64_t>(DATAGEN_BATCH, writer.remaining())) {
+			writer.write(file, batch);
+			batch.clear();
+		}
+	}
+	if (!batch.empty()) {
+		writer.write(file, batch);
+	}
+}
+
+int runDatagen(const std::vector<std::string>& args) {
+	if (!args.empty() && args[0] == "convert") {
+		if (args.size() < 2) {
+			std::cerr << "Usage: bearbot datagen convert <in.bin> [out.txt]" << std::endl;
+			return 1;
+		}
+		return convertPackedFile(args[1], args.size() > 2 ? args[2] : "");
+	}
+
+	std::string outputPath;
+	uint64_t positions = 1000000;
+	uint64_t nodes = 5000;
+	int threadCount = 0;
+	int randomPlies = 8;
+	uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	for (size_t i = 0; i + 1 < args.size(); i += 2) {
+		const std::string& option = args[i];
+		const std::string& value = args[i + 1];
+		if (option == "--output") outputPath = value;
+		else if (option == "--positions") positions = std::strtoull(value.c_str(), nullptr, 10);
+		else if (option == "--nodes") nodes = std::strtoull(value.c_str(), nullptr, 10);
+		else if (option == "--threads") threadCount = std::atoi(value.c_str());
+		else if (option == "--randomplies") randomPlies = std::atoi(value.c_str());
+		else if (option == "--seed") seed = std::strtoull(value.c_str(), nullptr, 10);
+		else {
+			std::cerr << "Unknown datagen option: " << option << std::endl;
+			return 1;
+		}
+	}
+	if (outputPath.empty() || args.size() % 2 != 0) {
+		std::cerr << "Usage: bearbot datagen --output FILE [--positions N] [--threads N] [--nodes N] [--randomplies N] [--seed N]" << std::endl;
+		return 1;
+	}
+	if (threadCount < 1) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Create (or truncate) the file, the workers then open it for positioned writes.
+	{
+		std::ofstream create(outputPath, std::ios::binary | std::ios::trunc);
+		if (!create) {
+			std::cerr << "Can't write " << outputPath << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "Generating " << positions << " positions with " << threadCount << " threads, "
+	          << nodes << " nodes per move" << std::endl;
+	auto start = std::chrono::steady_clock::now();
+	PackedWriter writer(outputPath, positions);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.emplace_back(datagenWorker, t, std::ref(writer), seed + t * 0x9E3779B97F4A7C15ULL, nodes, randomPlies);
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Wrote " << writer.written() << " positions to " << outputPath << " in " << elapsed.count() << " seconds ("
+	          << static_cast<uint64_t>(elapsed.count() > 0 ? writer.written() / elapsed.count() : 0) << " positions/s)" << std::endl;
+	return 0;
+}
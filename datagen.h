@@ -0,0 +1,55 @@
+#ifndef DATAGEN_H_
+#define DATAGEN_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "board.h"
+
+// One training position in 32 bytes, stored little-endian on disk:
+//
+//   bytes  0-7   occupancy, bit i set if square i holds a piece (i = 0 is a8, 63 is h1)
+//   bytes  8-23  one 4 bit piece code per set occupancy bit, low nibble first
+//                (0-5 white pawn..king, 6-11 black pawn..king)
+//   byte  24     bit 0: black to move, bits 1-4: castling rights KQkq
+//   byte  25     en passant file 0-7, or 8 for none
+//   byte  26     halfmove clock
+//   byte  27     game result from white's point of view: 0 loss, 1 draw, 2 win
+//   bytes 28-29  search score in centipawns from white's point of view (int16)
+//   bytes 30-31  fullmove number
+struct PackedPosition {
+	uint64_t occupancy = 0;
+	uint8_t pieces[16] = {};
+	uint8_t flags = 0;
+	uint8_t enPassantFile = 8;
+	uint8_t halfmoveClock = 0;
+	uint8_t result = 1;
+	int16_t score = 0;
+	uint16_t fullmove = 1;
+};
+
+const size_t PACKED_POSITION_BYTES = 32;
+
+PackedPosition packPosition(const Board& board, int whiteScore);
+std::string packedToFen(const PackedPosition& position);
+void writePackedPosition(const PackedPosition& position, unsigned char* bytes);
+bool readPackedPosition(const unsigned char* bytes, PackedPosition& position);
+
+// "bearbot datagen [options]" plays fixed-node self-play games and writes training positions.
+//
+//   --output FILE       packed positions are written here (required)
+//   --positions N       stop after N positions (default 1000000)
+//   --threads N         games played at once (default: all cores)
+//   --nodes N           search nodes per move (default 5000)
+//   --randomplies N     random moves played from the start position before searching (default 8)
+//   --seed N            base seed of the per-thread random generators
+//
+// Positions in check and positions whose best move is a capture are skipped. Each thread
+// collects a batch of positions and then reserves its own range of the output file, so
+// threads never wait on each other while writing.
+//
+// "bearbot datagen convert <in.bin> [out.txt]" prints the positions as "<fen> | <score> | <result>"
+// lines (result 1.0, 0.5 or 0.0 for white).
+int runDatagen(const std::vector<std::string>& args);
+
+#endif
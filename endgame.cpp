@@ -0,0 +1,352 @@
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include "endgame.h"
+#include "eval_params.h"
+
+// --- KPK bitbase ---
+//
+// Positions are seen from the side with the pawn ("strong"), pawn moving up. Mirroring the
+// board left to right keeps the pawn on files a-d, so 24 pawn squares (a2 .. d7) times 64
+// times 64 king squares. Only the strong side to move is kept, one bit per position (win or
+// not): 12 KB. With the weak side to move, probeKpk looks one move ahead instead.
+
+const int KPK_PAWN_SQUARES = 24;
+const int KPK_ENTRIES = KPK_PAWN_SQUARES * 64 * 64;
+
+static uint64_t kpkWins[KPK_ENTRIES / 64];
+static std::once_flag kpkBuilt;
+
+enum KpkResult : uint8_t { KPK_INVALID, KPK_UNKNOWN, KPK_DRAW, KPK_WIN };
+
+static int fileOf(int sq) { return sq & 7; }
+static int rankOf(int sq) { return sq >> 3; }
+
+static int distance(int a, int b) {
+	return std::max(std::abs(fileOf(a) - fileOf(b)), std::abs(rankOf(a) - rankOf(b)));
+}
+
+static bool pawnAttacks(int pawn, int sq) {
+	return rankOf(sq) == rankOf(pawn) + 1 && std::abs(fileOf(sq) - fileOf(pawn)) == 1;
+}
+
+// The up to 8 squares next to sq.
+static int kingMoves(int sq, int moves[8]) {
+	int n = 0;
+	for (int dr = -1; dr <= 1; dr++) {
+		for (int df = -1; df <= 1; df++) {
+			int r = rankOf(sq) + dr, f = fileOf(sq) + df;
+			if ((dr || df) && r >= 0 && r < 8 && f >= 0 && f < 8) {
+				moves[n++] = r * 8 + f;
+			}
+		}
+	}
+	return n;
+}
+
+// pawn on files a-d, ranks 2-7
+static int kpkEntry(int strongKing, int weakKing, int pawn) {
+	int pawnIndex = (rankOf(pawn) - 1) * 4 + fileOf(pawn);
+	return (pawnIndex * 64 + strongKing) * 64 + weakKing;
+}
+
+static bool kpkLookup(int strongKing, int weakKing, int pawn) {
+	int entry = kpkEntry(strongKing, weakKing, pawn);
+	return (kpkWins[entry / 64] >> (entry % 64)) & 1;
+}
+
+// Where the weak king can go: not next to the other king, not where the pawn attacks.
+// Taking the pawn is left out, the callers deal with it first.
+static int weakKingMoves(int strongKing, int weakKing, int pawn, int moves[8]) {
+	int all[8];
+	int n = 0;
+	for (int i = 0, count = kingMoves(weakKing, all); i < count; i++) {
+		int to = all[i];
+		if (to != pawn && distance(to, strongKing) > 1 && !pawnAttacks(pawn, to)) {
+			moves[n++] = to;
+		}
+	}
+	return n;
+}
+
+static KpkResult kpkClassify(bool strongToMove, int strongKing, int weakKing, int pawn) {
+	if (strongKing == weakKing || strongKing == pawn || weakKing == pawn || distance(strongKing, weakKing) <= 1) {
+		return KPK_INVALID;
+	}
+	if (strongToMove) {
+		if (pawnAttacks(pawn, weakKing)) {
+			return KPK_INVALID; // the weak side is in check but it isn't its move
+		}
+		// Promotes, and the queen can't be taken
+		int queen = pawn + 8;
+		if (rankOf(pawn) == 6 && strongKing != queen && weakKing != queen
+		    && (distance(weakKing, queen) > 1 || distance(strongKing, queen) == 1)) {
+			return KPK_WIN;
+		}
+		return KPK_UNKNOWN;
+	}
+	if (distance(weakKing, pawn) == 1 && distance(strongKing, pawn) > 1) {
+		return KPK_DRAW; // takes the pawn
+	}
+	int moves[8];
+	if (weakKingMoves(strongKing, weakKing, pawn, moves) == 0) {
+		return pawnAttacks(pawn, weakKing) ? KPK_WIN : KPK_DRAW; // mate or stalemate
+	}
+	return KPK_UNKNOWN;
+}
+
+static size_t kpkIndex(bool strongToMove, int entry) {
+	return static_cast<size_t>(entry) * 2 + (strongToMove ? 0 : 1);
+}
+
+// One pass over the undecided positions. The strong side wins if some move wins and draws
+// if every move draws; the weak side the other way round. True if anything was decided.
+static bool kpkIterate(std::vector<KpkResult>& results) {
+	bool changed = false;
+	for (int pawnIndex = 0; pawnIndex < KPK_PAWN_SQUARES; pawnIndex++) {
+		int pawn = (pawnIndex / 4 + 1) * 8 + pawnIndex % 4;
+		for (int strongKing = 0; strongKing < 64; strongKing++) {
+			for (int weakKing = 0; weakKing < 64; weakKing++) {
+				int entry = kpkEntry(strongKing, weakKing, pawn);
+				for (int side = 0; side < 2; side++) {
+					bool strongToMove = (side == 0);
+					KpkResult& result = results[kpkIndex(strongToMove, entry)];
+					if (result != KPK_UNKNOWN) {
+						continue;
+					}
+					bool anyGood = false, allBad = true;
+					auto see = [&](KpkResult next, KpkResult good, KpkResult bad) {
+						anyGood |= (next == good);
+						allBad &= (next == bad);
+					};
+					if (strongToMove) {
+						int all[8];
+						for (int i = 0, count = kingMoves(strongKing, all); i < count; i++) {
+							int to = all[i];
+							if (to != pawn && distance(to, weakKing) > 1) {
+								see(results[kpkIndex(false, kpkEntry(to, weakKing, pawn))], KPK_WIN, KPK_DRAW);
+							}
+						}
+						// Promotions are all in kpkClassify: one that isn't a win there loses the queen.
+						int push = pawn + 8;
+						if (rankOf(pawn) < 6 && push != strongKing && push != weakKing) {
+							see(results[kpkIndex(false, kpkEntry(strongKing, weakKing, push))], KPK_WIN, KPK_DRAW);
+							int doublePush = push + 8;
+							if (rankOf(pawn) == 1 && doublePush != strongKing && doublePush != weakKing) {
+								see(results[kpkIndex(false, kpkEntry(strongKing, weakKing, doublePush))], KPK_WIN, KPK_DRAW);
+							}
+						}
+					} else {
+						int moves[8];
+						for (int i = 0, count = weakKingMoves(strongKing, weakKing, pawn, moves); i < count; i++) {
+							see(results[kpkIndex(true, kpkEntry(strongKing, moves[i], pawn))], KPK_DRAW, KPK_WIN);
+						}
+					}
+					if (anyGood) {
+						result = strongToMove ? KPK_WIN : KPK_DRAW;
+						changed = true;
+					} else if (allBad) {
+						result = strongToMove ? KPK_DRAW : KPK_WIN;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+	return changed;
+}
+
+static void buildKpk() {
+	std::vector<KpkResult> results(static_cast<size_t>(KPK_ENTRIES) * 2);
+	for (int pawnIndex = 0; pawnIndex < KPK_PAWN_SQUARES; pawnIndex++) {
+		int pawn = (pawnIndex / 4 + 1) * 8 + pawnIndex % 4;
+		for (int strongKing = 0; strongKing < 64; strongKing++) {
+			for (int weakKing = 0; weakKing < 64; weakKing++) {
+				int entry = kpkEntry(strongKing, weakKing, pawn);
+				results[kpkIndex(true, entry)] = kpkClassify(true, strongKing, weakKing, pawn);
+				results[kpkIndex(false, entry)] = kpkClassify(false, strongKing, weakKing, pawn);
+			}
+		}
+	}
+	while (kpkIterate(results)) {
+	}
+	// Whatever is still undecided can't be forced: a draw.
+	for (int entry = 0; entry < KPK_ENTRIES; entry++) {
+		if (results[kpkIndex(true, entry)] == KPK_WIN) {
+			kpkWins[entry / 64] |= uint64_t(1) << (entry % 64);
+		}
+	}
+}
+
+void initEndgames() {
+	std::call_once(kpkBuilt, buildKpk);
+}
+
+bool probeKpk(int strongKing, int strongPawn, int weakKing, bool strongToMove) {
+	initEndgames();
+	if (rankOf(strongPawn) < 1 || rankOf(strongPawn) > 6) {
+		return false;
+	}
+	if (fileOf(strongPawn) > 3) {
+		strongKing ^= 7;
+		strongPawn ^= 7;
+		weakKing ^= 7;
+	}
+	if (strongToMove) {
+		return kpkLookup(strongKing, weakKing, strongPawn);
+	}
+	// Weak side to move: a win only if every reply is one.
+	if (distance(weakKing, strongPawn) == 1 && distance(strongKing, strongPawn) > 1) {
+		return false;
+	}
+	int moves[8];
+	int count = weakKingMoves(strongKing, weakKing, strongPawn, moves);
+	if (count == 0) {
+		return pawnAttacks(strongPawn, weakKing);
+	}
+	for (int i = 0; i < count; i++) {
+		if (!kpkLookup(strongKing, moves[i], strongPawn)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// --- Evaluators ---
+
+struct EndgameMaterial {
+	int count[2][6] = {};     // [white, black][pawn .. king]
+	int square[2][6] = {};    // the last one of each kind found
+	int bishopColors[2] = {}; // 1 if a bishop is on a dark square, 2 if one is on a light square
+	int pieces = 0;           // everything but the kings
+
+	explicit EndgameMaterial(const Board& board) {
+		for (int row = 2; row < BOARD_ROWS - 2; ++row) {
+			for (int col = 1; col < BOARD_COLS - 1; ++col) {
+				Piece piece = board.getPieceAt(row, col);
+				if (piece.getType() == PieceType::EMPTY) {
+					continue;
+				}
+				int type = static_cast<int>(piece.getType()) - 1;
+				int side = (piece.getColor() == PieceColor::WHITE) ? 0 : 1;
+				int sq = (9 - row) * 8 + (col - 1);
+				count[side][type]++;
+				square[side][type] = sq;
+				if (type == 2) {
+					bishopColors[side] |= (rankOf(sq) + fileOf(sq)) % 2 ? 2 : 1;
+				}
+				if (type != 5) {
+					pieces++;
+				}
+			}
+		}
+	}
+};
+
+// 0 in the centre, 6 in a corner
+static int edgeDistance(int sq) {
+	return std::max(3 - fileOf(sq), fileOf(sq) - 4) + std::max(3 - rankOf(sq), rankOf(sq) - 4);
+}
+
+static int materialOf(const EndgameMaterial& material, int side) {
+	int total = 0;
+	for (int type = 0; type < 5; type++) {
+		total += material.count[side][type] * PIECE_VALUES[type];
+	}
+	return total;
+}
+
+// KQK, KRK, KBBK and the like: the material wins, the search just has to find the mate.
+// Drive the lone king to the edge and bring the other king up.
+static int evaluateMateAgainstBareKing(const EndgameMaterial& material, int strong) {
+	int strongKing = material.square[strong][5], weakKing = material.square[1 - strong][5];
+	return KNOWN_WIN + materialOf(material, strong) + 20 * edgeDistance(weakKing) + 10 * (7 - distance(strongKing, weakKing));
+}
+
+// KBNK: mate only works in a corner the bishop can reach.
+static int evaluateKbnk(const EndgameMaterial& material, int strong) {
+	int strongKing = material.square[strong][5], weakKing = material.square[1 - strong][5];
+	bool lightBishop = material.bishopColors[strong] == 2;
+	int corner = lightBishop ? std::min(distance(weakKing, 56), distance(weakKing, 7))   // a8, h1
+	                         : std::min(distance(weakKing, 0), distance(weakKing, 63));  // a1, h8
+	return KNOWN_WIN + materialOf(material, strong) + 40 * (7 - corner) + 10 * edgeDistance(weakKing)
+	       + 10 * (7 - distance(strongKing, weakKing));
+}
+
+bool evaluateEndgame(const Board& board, int& score) {
+	EndgameMaterial material(board);
+	PieceColor sideToMove = board.getCurrentPlayer();
+	if (material.pieces > ENDGAME_MAX_PIECES) {
+		return false;
+	}
+	const int (&count)[2][6] = material.count;
+	int pawns = count[0][0] + count[1][0];
+
+	if (material.pieces == 1 && pawns == 1) {
+		int strong = count[0][0] ? 0 : 1;
+		int flip = (strong == 0) ? 0 : 56; // black's pawn moves down: look from its side
+		int pawn = material.square[strong][0] ^ flip;
+		bool strongToMove = (sideToMove == PieceColor::WHITE) == (strong == 0);
+		int result = 0;
+		if (probeKpk(material.square[strong][5] ^ flip, pawn, material.square[1 - strong][5] ^ flip, strongToMove)) {
+			result = KNOWN_WIN + PIECE_VALUES[0] + 20 * rankOf(pawn);
+		}
+		score = (strong == 0) ? result : -result;
+		return true;
+	}
+	if (pawns > 0) {
+		return false;
+	}
+
+	int minors[2], majors[2];
+	for (int side = 0; side < 2; side++) {
+		minors[side] = count[side][1] + count[side][2];
+		majors[side] = count[side][3] + count[side][4];
+	}
+
+	// Nobody can mate: KK, KNK, KBK, minor against minor, KNNK
+	if (majors[0] == 0 && majors[1] == 0) {
+		if (minors[0] <= 1 && minors[1] <= 1) {
+			score = 0;
+			return true;
+		}
+		for (int side = 0; side < 2; side++) {
+			if (count[side][1] == 2 && count[side][2] == 0 && minors[1 - side] == 0) {
+				score = 0;
+				return true;
+			}
+		}
+	}
+
+	for (int strong = 0; strong < 2; strong++) {
+		if (minors[1 - strong] + majors[1 - strong] > 0) {
+			continue;
+		}
+		int result;
+		if (majors[strong] > 0) {
+			result = evaluateMateAgainstBareKing(material, strong);
+		} else if (count[strong][1] >= 1 && count[strong][2] >= 1) {
+			result = evaluateKbnk(material, strong);
+		} else if (material.bishopColors[strong] == 3) {
+			result = evaluateMateAgainstBareKing(material, strong);
+		} else {
+			return false; // same coloured bishops, or three knights
+		}
+		score = (strong == 0) ? result : -result;
+		return true;
+	}
+
+	// A rook against a minor piece is usually a draw: keep a little for the rook's side
+	// and let the search look for the exceptions.
+	for (int strong = 0; strong < 2; strong++) {
+		if (count[strong][3] == 1 && material.pieces == 2 && minors[1 - strong] == 1) {
+			int result = (PIECE_VALUES[3] - materialOf(material, 1 - strong)) / 4
+			             + 5 * edgeDistance(material.square[1 - strong][5]);
+			score = (strong == 0) ? result : -result;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,27 @@
+#ifndef ENDGAME_H_
+#define ENDGAME_H_
+
+#include <cstdint>
+#include "board.h"
+
+// Endgames the material count gets wrong: KPK is looked up in a bitbase, won endings
+// against a bare king are driven towards mate, and material that can't win is scored as a
+// draw. evaluatePosition asks here first when only a few pieces are left.
+//
+// Squares in this file count from a1 = 0 to h8 = 63 (not the board's a8 = 0).
+
+const int KNOWN_WIN = 10000;       // well below mate scores, well above any material count
+const int ENDGAME_MAX_PIECES = 3;  // non-king pieces on the board for a position to be looked at
+const int ENDGAME_VERSION = 1;     // raise when evaluateEndgame scores anything differently (see search_cache.h)
+
+// Builds the KPK bitbase. Runs once, a few dozen milliseconds; later calls return straight away.
+void initEndgames();
+
+// KPK from the side with the pawn, the pawn moving up the board. True if that side wins.
+bool probeKpk(int strongKing, int strongPawn, int weakKing, bool strongToMove);
+
+// Score from white's point of view if the position is a known endgame, false otherwise.
+// evaluatePosition only calls it with at most ENDGAME_MAX_PIECES pieces besides the kings.
+bool evaluateEndgame(const Board& board, int& score);
+
+#endif
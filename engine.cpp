@@ -9,9 +9,16 @@
 #include <atomic>
 #include <functional>
 #include <chrono>
+#include <fstream>
+#include <algorithm>
 
 #include "engine.h"
+#include "eval_params.h"
 #include "board.h"
+#include "epd.h"
+#include "numa.h"
+#include "profile.h"
+#include "endgame.h"
 
 std::string convertCoordsToUci(int r, int c) {
     char file = 'a' + (c - 1); // 'a' + (5 - 1) = 'e'
@@ -314,6 +321,7 @@ std::vector<std::string> generatePawnMoves(Board &board, int r, int c) {
 }
 
 std::vector<std::string> generatePseudoLegalMoves(Board& board) { // Pass board by reference
+	BEARBOT_PROFILE_SCOPE(PROFILE_MOVEGEN);
 	std::vector<std::string> generatedMoves;
 	PieceColor currentPlayer = board.getCurrentPlayer();
 	
@@ -363,6 +371,7 @@ std::vector<std::string> generatePseudoLegalMoves(Board& board) { // Pass board
 
 // This function filters the pseudo-legal moves to produce only fully legal moves.
 std::vector<std::string> generateLegalMoves(Board& board) {
+    BEARBOT_PROFILE_SCOPE(PROFILE_LEGAL);
     std::vector<std::string> legalMoves;
     std::vector<std::string> pseudoLegalMoves = generatePseudoLegalMoves(board);
     PieceColor currentPlayer = board.getCurrentPlayer();
@@ -378,72 +387,31 @@ std::vector<std::string> generateLegalMoves(Board& board) {
 }
 
 double evaluatePosition(Board& board) {
+	BEARBOT_PROFILE_SCOPE(PROFILE_EVALUATE);
 	double evalScore = 0;
+	int pieces = 0; // besides the kings
 	for (int row = 2; row < BOARD_ROWS - 2; ++row) {
 		for (int col = 1; col < BOARD_COLS - 1; ++col) {
 			Piece currentPiece = board.getPieceAt(row, col);
+			if (currentPiece.getType() == PieceType::EMPTY) {
+				continue;
+			}
+			int type = static_cast<int>(currentPiece.getType()) - 1;
+			int square = (row - 2) * 8 + (col - 1);
 			if (currentPiece.getColor() == PieceColor::WHITE) {
-				switch (currentPiece.getType()) {
-					case PieceType::KING: {
-						evalScore += 99999;
-						break;
-					}
-					case PieceType::QUEEN: {
-						evalScore += 900;
-						break;
-					}
-					case PieceType::BISHOP: {
-						evalScore += 320;
-						break;
-					}
-					case PieceType::KNIGHT: {
-						evalScore += 310;
-						break;
-					}
-					case PieceType::ROOK: {
-						evalScore += 500;
-						break;
-					}
-					case PieceType::PAWN: {
-						evalScore += 100;
-						break;
-					}
-					default:
-						break;
-				}
+				evalScore += PIECE_VALUES[type] + PIECE_SQUARE[type][square];
 			}
 			else {
-				switch (currentPiece.getType()) {
-					case PieceType::KING: {
-						evalScore -= 99999;
-						break;
-					}
-					case PieceType::QUEEN: {
-						evalScore -= 900;
-						break;
-					}
-					case PieceType::BISHOP: {
-						evalScore -= 320;
-						break;
-					}
-					case PieceType::KNIGHT: {
-						evalScore -= 310;
-						break;
-					}
-					case PieceType::ROOK: {
-						evalScore -= 500;
-						break;
-					}
-					case PieceType::PAWN: {
-						evalScore -= 100;
-						break;
-					}
-					default:
-						break;
-				}
+				evalScore -= PIECE_VALUES[type] + PIECE_SQUARE[type][square ^ 56];
 			}
+			pieces += (type != 5);
 		}
 	}
+	// Known wins and draws (endgame.h) instead of the material count
+	int endgameScore;
+	if (pieces <= ENDGAME_MAX_PIECES && evaluateEndgame(board, endgameScore)) {
+		return endgameScore;
+	}
 	return evalScore;
 }
         
@@ -502,11 +470,13 @@ uint64_t Perft_parallel(Board& board, int depth) {
     std::vector<std::thread> threads;
 
     // Create a thread for each move from the root
-    for (const std::string& move : moves) {
-        // We need a copy of the board for each thread to work on
-        Board threadBoard = board;
-
-        threads.emplace_back([move, threadBoard, depth, &totalNodes]() mutable {
+    for (size_t i = 0; i < moves.size(); i++) {
+        const std::string& move = moves[i];
+        threads.emplace_back([move, i, &board, depth, &totalNodes]() {
+            // Each thread works on its own copy of the board, made after pinning so it's
+            // allocated on the thread's own node. Nobody changes board until we've joined.
+            pinWorkerThread(static_cast<int>(i));
+            Board threadBoard = board;
             threadBoard.pushMove(move);
             uint64_t result = Perft_recursive(threadBoard, depth - 1);
             totalNodes += result;
@@ -539,50 +509,129 @@ void PerftTest(Board& board, int depth) {
     std::cout << "-------------------" << std::endl;
 }
 
-std::string search(Board& board) {
-	std::vector<std::string> moves = generateLegalMoves(board);
-//	if (moves.empty()) {
-//        return ""; // Return an empty string or handle no-moves case
-//    }
-//	int depth = 1;
-//	bool maximizingPlayer = board.getCurrentPlayer() == PieceColor::WHITE;
-//	double bestmoveScore;
-//	std::string bestmove = moves[0];
-//	
-//	PieceColor currentPlayer = board.getCurrentPlayer();
-//	
-//    if (currentPlayer == PieceColor::WHITE) {
-//        bestmoveScore = -std::numeric_limits<double>::infinity(); // White wants the highest score
-//    }
-//	else {
-//        bestmoveScore = std::numeric_limits<double>::infinity(); // Black wants the lowest score
-//    }
-//	
-//	for (std::string move : moves) {
-//		
-//		// 2. Simulate the move on a temporary board
-//        Board boardCopy = board;
-//        boardCopy.pushMove(move);
-//
-//        // 3. Call minimax ONCE on the new board state and store the score
-//        // The 'isMaximizingPlayer' is the OPPOSITE of the current player, as it's for the next turn
-//        bool isMaximizingPlayerAfterMove = (boardCopy.getCurrentPlayer() == PieceColor::WHITE);
-//        double eval = minimax(boardCopy, depth - 1, isMaximizingPlayerAfterMove);
-//		
-//		if (currentPlayer == PieceColor::WHITE) {
-//			if (eval > bestmoveScore) {
-//				bestmoveScore = eval;
-//				bestmove = move;
-//			}
-//		}
-//		else {
-//			if (eval < bestmoveScore) {
-//				bestmoveScore = eval;
-//				bestmove = move;
-//			}
-//		}
-//	}
-//	std::cout << "Evaluation Score: " << evaluatePosition(board) << std::endl;
-//	// return bestmove;
-	return moves[rand() % moves.size()];
-}
\ No newline at end of file
+// Perft split by root move, e.g. "e2e4: 13160". Handy for finding which move a movegen bug hides under.
+void PerftDivide(Board& board, int depth) {
+    std::cout << "Perft divide depth " << depth << std::endl;
+    if (depth < 1) {
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::string> moves = generateLegalMoves(board);
+    uint64_t totalNodes = 0;
+    for (const std::string& move : moves) {
+        board.pushMove(move);
+        uint64_t nodes = Perft_recursive(board, depth - 1);
+        board.popMove(move);
+        totalNodes += nodes;
+        std::cout << move << ": " << nodes << std::endl;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+
+    std::cout << "Moves: " << moves.size() << std::endl;
+    std::cout << "Nodes: " << totalNodes << std::endl;
+    std::cout << "Time: " << elapsed.count() << " seconds" << std::endl;
+    std::cout << "-------------------" << std::endl;
+}
+
+// Runs every position of a perft EPD file (";D1 20 ;D2 400 ..." operations) up to maxDepth,
+// spreading the positions over threadCount threads. Returns false if any count doesn't match.
+bool PerftEpdSuite(const std::string& path, int maxDepth, int threadCount) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "Can't open " << path << std::endl;
+        return false;
+    }
+
+    struct PerftCase {
+        std::string fen;
+        std::vector<std::pair<int, uint64_t>> expected; // depth, nodes
+        std::vector<std::string> failures;
+        uint64_t nodes = 0;
+    };
+    std::vector<PerftCase> cases;
+    int unchecked = 0; // positions without a count at or below maxDepth
+    std::string line;
+    while (std::getline(file, line)) {
+        EpdRecord record;
+        if (!parseEpdLine(line, record)) {
+            continue;
+        }
+        PerftCase perftCase;
+        perftCase.fen = record.fen;
+        for (const auto& op : record.operations) {
+            if (op.first.size() > 1 && op.first[0] == 'D') {
+                int depth = std::atoi(op.first.c_str() + 1);
+                if (depth >= 1 && depth <= maxDepth) {
+                    perftCase.expected.push_back({depth, std::strtoull(op.second.c_str(), nullptr, 10)});
+                }
+            }
+        }
+        if (perftCase.expected.empty()) {
+            unchecked++;
+            continue;
+        }
+        cases.push_back(perftCase);
+    }
+
+    if (threadCount < 1) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::cout << "Perft suite " << path << ": " << cases.size() << " positions, max depth " << maxDepth
+              << ", " << threadCount << " threads" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::atomic<size_t> nextCase(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&cases, &nextCase, t]() {
+            pinWorkerThread(t);
+            for (size_t i = nextCase++; i < cases.size(); i = nextCase++) {
+                PerftCase& perftCase = cases[i];
+                Board board;
+                if (!board.loadFen(perftCase.fen)) {
+                    perftCase.failures.push_back("invalid fen");
+                    continue;
+                }
+                for (const auto& expected : perftCase.expected) {
+                    uint64_t nodes = Perft_recursive(board, expected.first);
+                    perftCase.nodes += nodes;
+                    if (nodes != expected.second) {
+                        perftCase.failures.push_back("D" + std::to_string(expected.first) + " expected " +
+                            std::to_string(expected.second) + " got " + std::to_string(nodes));
+                    }
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+
+    uint64_t totalNodes = 0;
+    int failed = 0;
+    for (const PerftCase& perftCase : cases) {
+        totalNodes += perftCase.nodes;
+        if (!perftCase.failures.empty()) {
+            failed++;
+            std::cout << "FAIL " << perftCase.fen << std::endl;
+            for (const std::string& failure : perftCase.failures) {
+                std::cout << "     " << failure << std::endl;
+            }
+        }
+    }
+    double nps = (elapsed.count() > 0) ? totalNodes / elapsed.count() : 0;
+
+    std::cout << "Passed: " << (cases.size() - failed) << "/" << cases.size() << std::endl;
+    if (unchecked > 0) {
+        std::cout << "Unchecked: " << unchecked << " (no D1 .. D" << maxDepth << " count)" << std::endl;
+    }
+    std::cout << "Nodes: " << totalNodes << std::endl;
+    std::cout << "Time: " << elapsed.count() << " seconds" << std::endl;
+    std::cout << "NPS (Nodes Per Second): " << static_cast<uint64_t>(nps) << std::endl;
+    std::cout << "-------------------" << std::endl;
+    return failed == 0;
+}
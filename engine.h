@@ -31,7 +31,7 @@ double minimax(Board& board, int depth, bool maximizingPlayer);
 uint64_t Perft_recursive(Board& board, int depth);
 uint64_t Perft_parallel(Board& board, int depth);
 void PerftTest(Board& board, int depth);
-
-std::string search(Board& board);
+void PerftDivide(Board& board, int depth);
+bool PerftEpdSuite(const std::string& path, int maxDepth, int threadCount);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+
+#include "engine_api.h"
+#include "engine.h"
+
+bool applyPosition(Board& board, PositionState& state, const std::string& base, const std::vector<std::string>& moves) {
+	// A different base position means there is nothing to reuse.
+	if (base != state.base) {
+		if (base == "startpos") {
+			board.initializeBoard();
+		} else if (!board.loadFen(base)) {
+			state = PositionState();
+			return false;
+		}
+		state.base = base;
+		state.moves.clear();
+	}
+
+	// Keep the moves both lists agree on, take back the rest of the old list
+	// and play the rest of the new one. In a normal game this is one or two pushMove calls.
+	size_t common = 0;
+	while (common < state.moves.size() && common < moves.size() && state.moves[common] == moves[common]) {
+		common++;
+	}
+	for (size_t m = state.moves.size(); m > common; m--) {
+		board.popMove(state.moves[m - 1]);
+	}
+	state.moves.resize(common);
+	for (size_t m = common; m < moves.size(); m++) {
+		std::vector<std::string> legal = generateLegalMoves(board);
+		if (std::find(legal.begin(), legal.end(), moves[m]) == legal.end()) {
+			return false;
+		}
+		board.pushMove(moves[m]);
+		state.moves.push_back(moves[m]);
+	}
+	return true;
+}
+
+Engine::Engine() {}
+
+Engine::~Engine() {
+	stop();
+}
+
+bool Engine::setPosition(const std::string& base, const std::vector<std::string>& moves) {
+	stop();
+	return applyPosition(board_, position, base, moves);
+}
+
+void Engine::newGame() {
+	stop();
+	board_.initializeBoard();
+	position = PositionState();
+}
+
+void Engine::setParams(const SearchParams& params) {
+	this->params = params;
+}
+
+const SearchParams& Engine::getParams() const {
+	return params;
+}
+
+void Engine::setDebug(bool debug) {
+	this->debug = debug;
+}
+
+void Engine::setMultiPV(int lines) {
+	multiPV = std::max(1, lines);
+}
+
+void Engine::setUciOutput(bool enabled) {
+	uciOutput = enabled;
+}
+
+void Engine::setSearchCache(std::shared_ptr<SearchCache> cache) {
+	stop();
+	searchCache = cache;
+}
+
+void Engine::setTraceLog(std::shared_ptr<TraceLog> log) {
+	stop();
+	if (context) {
+		context->trace.reset();
+	}
+	traceLog = log;
+}
+
+void Engine::prepareContext(const SearchLimits& limits, InfoCallback onInfo) {
+	// Keep the eval cache warm from one search to the next.
+	EvalCache evalCache;
+	if (context) {
+		std::swap(evalCache, context->evalCache);
+	}
+	context.reset(new SearchContext());
+	std::swap(context->evalCache, evalCache);
+	context->limits = limits;
+	context->params = params;
+	context->multiPV = multiPV;
+	context->debug = debug && uciOutput;
+	context->reportInfo = uciOutput;
+	context->onIteration = onInfo;
+	context->searchCache = searchCache.get();
+	if (traceLog) {
+		context->trace.reset(new TraceWriter(*traceLog));
+	}
+}
+
+bool Engine::go(const SearchLimits& limits, BestMoveCallback onBestMove, InfoCallback onInfo, bool ponder) {
+	if (searching) {
+		return false;
+	}
+	if (searchThread.joinable()) {
+		searchThread.join();
+	}
+	prepareContext(limits, onInfo);
+	context->pondering = ponder;
+	searching = true;
+	searchThread = std::thread([this, onBestMove]() {
+		SearchResult result = ::search(board_, *context);
+		// While pondering or in infinite mode the GUI has to hear from us only after "ponderhit" or "stop".
+		while ((context->pondering || context->limits.infinite) && !context->stopRequested) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (onBestMove) {
+			onBestMove(result);
+		}
+		searching = false;
+	});
+	return true;
+}
+
+SearchResult Engine::search(const SearchLimits& limits, InfoCallback onInfo) {
+	stop();
+	prepareContext(limits, onInfo);
+	return ::search(board_, *context);
+}
+
+void Engine::ponderhit() {
+	if (searching) {
+		context->pondering = false;
+	}
+}
+
+void Engine::stop() {
+	if (searchThread.joinable()) {
+		context->stopRequested = true;
+		searchThread.join();
+	}
+}
+
+void Engine::wait() {
+	if (searchThread.joinable()) {
+		searchThread.join();
+	}
+}
+
+bool Engine::isSearching() const {
+	return searching;
+}
+
+Board& Engine::board() {
+	return board_;
+}
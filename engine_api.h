@@ -0,0 +1,85 @@
+#ifndef ENGINE_API_H_
+#define ENGINE_API_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "board.h"
+#include "search.h"
+
+// Remembers what the last position command put on the board, so the next one
+// only has to apply the moves that were added (or take back the ones that were removed).
+struct PositionState {
+	std::string base;               // "startpos" or the FEN the moves are played from
+	std::vector<std::string> moves; // moves currently pushed on top of base
+};
+
+// Puts base + moves on the board, reusing whatever state already has in common with it.
+// False if the FEN is invalid or a move is illegal; the board then holds the position
+// up to the last good move and state says which one that is.
+bool applyPosition(Board& board, PositionState& state, const std::string& base, const std::vector<std::string>& moves);
+
+// One self-contained engine: its own board, search thread and search state. Any number
+// of these can run side by side in one process (see engine_c.h for the C API).
+//
+// The methods are meant to be called from one controlling thread. The callbacks run on
+// the engine's search thread and must not call back into the same Engine. Nothing is
+// printed unless setUciOutput(true) is called.
+class Engine {
+public:
+	using InfoCallback = std::function<void(const SearchResult& iteration)>;
+	using BestMoveCallback = std::function<void(const SearchResult& result)>;
+
+	Engine();
+	~Engine();
+	Engine(const Engine&) = delete;
+	Engine& operator=(const Engine&) = delete;
+
+	// base is "startpos" or a FEN. Stops a running search first.
+	bool setPosition(const std::string& base, const std::vector<std::string>& moves = {});
+	void newGame();
+	void setParams(const SearchParams& params);
+	const SearchParams& getParams() const;
+	void setDebug(bool debug);
+	void setMultiPV(int lines); // the best N root moves with their lines, reported per iteration
+	void setUciOutput(bool enabled); // UCI info lines and the debug stats dump on stdout
+	// Results kept on disk across sessions (see search_cache.h), null for none. Several
+	// engines may share one. Stops a running search first.
+	void setSearchCache(std::shared_ptr<SearchCache> cache);
+	// Records every node of the following searches in log (see trace.h), null to stop.
+	void setTraceLog(std::shared_ptr<TraceLog> log);
+
+	// Starts searching in the background and returns right away. onBestMove is called once
+	// when the search is over; while pondering or in infinite mode that is only after
+	// ponderhit()/stop(). False if a search is already running.
+	bool go(const SearchLimits& limits, BestMoveCallback onBestMove, InfoCallback onInfo = nullptr, bool ponder = false);
+	// Searches on the calling thread.
+	SearchResult search(const SearchLimits& limits, InfoCallback onInfo = nullptr);
+	void ponderhit();
+	void stop();   // ends the running search and waits until onBestMove has returned
+	void wait();   // waits for the running search to finish on its own
+	bool isSearching() const;
+
+	// Only to be used while no search is running.
+	Board& board();
+
+private:
+	void prepareContext(const SearchLimits& limits, InfoCallback onInfo);
+
+	Board board_;
+	PositionState position;
+	SearchParams params;
+	bool debug = false;
+	int multiPV = 1;
+	bool uciOutput = false;
+	std::shared_ptr<SearchCache> searchCache;
+	std::shared_ptr<TraceLog> traceLog; // outlives context, whose writer logs to it
+	std::unique_ptr<SearchContext> context;
+	std::thread searchThread;
+	std::atomic<bool> searching{false};
+};
+
+#endif
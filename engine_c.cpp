@@ -0,0 +1,159 @@
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include "engine_c.h"
+#include "engine_api.h"
+#include "uci.h"
+
+struct bearbot_engine {
+	Engine engine;
+};
+
+// Keeps the strings a bearbot_result points to alive for the duration of a callback.
+struct ResultStrings {
+	std::string bestMove, ponderMove, pv;
+};
+
+static bearbot_result toCResult(const SearchResult& result, ResultStrings& strings) {
+	strings.bestMove = result.bestMove.empty() ? "0000" : result.bestMove;
+	strings.ponderMove = result.pv.size() > 1 ? result.pv[1] : "";
+	strings.pv.clear();
+	for (const std::string& move : result.pv) {
+		strings.pv += (strings.pv.empty() ? "" : " ") + move;
+	}
+
+	bearbot_result out;
+	out.best_move = strings.bestMove.c_str();
+	out.ponder_move = strings.ponderMove.c_str();
+	out.pv = strings.pv.c_str();
+	out.score_cp = result.score;
+	out.mate = 0;
+	if (result.score > MATE_SCORE - MAX_PLY) {
+		out.mate = (MATE_SCORE - result.score + 1) / 2;
+	} else if (result.score < -MATE_SCORE + MAX_PLY) {
+		out.mate = -(MATE_SCORE + result.score) / 2;
+	}
+	out.depth = result.depth;
+	out.nodes = result.nodes;
+	out.time_ms = result.timeMs;
+	return out;
+}
+
+static Engine::BestMoveCallback wrapCallback(bearbot_result_callback callback, void* userData) {
+	if (!callback) {
+		return nullptr;
+	}
+	return [callback, userData](const SearchResult& result) {
+		ResultStrings strings;
+		bearbot_result out = toCResult(result, strings);
+		callback(&out, userData);
+	};
+}
+
+// Same meaning as the UCI "go" command, so reuse its parser.
+static SearchLimits toSearchLimits(const bearbot_limits* limits, PieceColor sideToMove) {
+	std::vector<std::string> go = {"go"};
+	if (limits) {
+		auto add = [&go](const char* name, long long value) {
+			go.push_back(name);
+			go.push_back(std::to_string(value));
+		};
+		if (limits->depth > 0) add("depth", limits->depth);
+		if (limits->nodes > 0) add("nodes", static_cast<long long>(limits->nodes));
+		if (limits->movetime > 0) add("movetime", limits->movetime);
+		if (limits->wtime >= 0) add("wtime", limits->wtime);
+		if (limits->btime >= 0) add("btime", limits->btime);
+		if (limits->winc > 0) add("winc", limits->winc);
+		if (limits->binc > 0) add("binc", limits->binc);
+		if (limits->movestogo > 0) add("movestogo", limits->movestogo);
+		if (limits->infinite) go.push_back("infinite");
+	}
+	bool ponder;
+	return parseGoLimits(go, sideToMove, ponder);
+}
+
+extern "C" {
+
+int bearbot_api_version(void) {
+	return BEARBOT_API_VERSION;
+}
+
+bearbot_engine* bearbot_engine_new(void) {
+	return new bearbot_engine();
+}
+
+void bearbot_engine_free(bearbot_engine* engine) {
+	delete engine;
+}
+
+int bearbot_set_position(bearbot_engine* engine, const char* position, const char* moves) {
+	std::vector<std::string> moveList;
+	if (moves) {
+		std::stringstream ss(moves);
+		std::string move;
+		while (ss >> move) {
+			moveList.push_back(move);
+		}
+	}
+	return engine->engine.setPosition(position ? position : "startpos", moveList) ? 1 : 0;
+}
+
+void bearbot_new_game(bearbot_engine* engine) {
+	engine->engine.newGame();
+}
+
+int bearbot_set_param(bearbot_engine* engine, const char* name, int value) {
+	SearchParams params = engine->engine.getParams();
+	if (!name || !params.set(name, value)) {
+		return 0;
+	}
+	engine->engine.setParams(params);
+	return 1;
+}
+
+void bearbot_limits_init(bearbot_limits* limits) {
+	limits->depth = 0;
+	limits->nodes = 0;
+	limits->movetime = 0;
+	limits->wtime = limits->btime = -1;
+	limits->winc = limits->binc = 0;
+	limits->movestogo = 0;
+	limits->infinite = 0;
+}
+
+int bearbot_go(bearbot_engine* engine, const bearbot_limits* limits, int ponder,
+               bearbot_result_callback on_bestmove, bearbot_result_callback on_info, void* user_data) {
+	if (engine->engine.isSearching()) {
+		return 0;
+	}
+	SearchLimits searchLimits = toSearchLimits(limits, engine->engine.board().getCurrentPlayer());
+	return engine->engine.go(searchLimits, wrapCallback(on_bestmove, user_data), wrapCallback(on_info, user_data), ponder != 0) ? 1 : 0;
+}
+
+void bearbot_search(bearbot_engine* engine, const bearbot_limits* limits, bearbot_result_callback on_result, void* user_data) {
+	engine->engine.stop();
+	SearchLimits searchLimits = toSearchLimits(limits, engine->engine.board().getCurrentPlayer());
+	SearchResult result = engine->engine.search(searchLimits);
+	if (on_result) {
+		wrapCallback(on_result, user_data)(result);
+	}
+}
+
+void bearbot_ponderhit(bearbot_engine* engine) {
+	engine->engine.ponderhit();
+}
+
+void bearbot_stop(bearbot_engine* engine) {
+	engine->engine.stop();
+}
+
+void bearbot_wait(bearbot_engine* engine) {
+	engine->engine.wait();
+}
+
+int bearbot_is_searching(bearbot_engine* engine) {
+	return engine->engine.isSearching() ? 1 : 0;
+}
+
+}
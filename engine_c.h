@@ -0,0 +1,87 @@
+#ifndef ENGINE_C_H_
+#define ENGINE_C_H_
+
+/* C interface to the engine, built into the bearbot-engine shared library.
+ *
+ * Every bearbot_engine is independent (own board, search thread and state), so a process
+ * can run as many games at once as it likes. Calls on one engine must come from one thread
+ * at a time. Callbacks run on the engine's search thread and must not call back into the
+ * same engine. Strings handed to callbacks are only valid during the callback. */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(BEARBOT_BUILDING_LIBRARY)
+#    define BEARBOT_API __declspec(dllexport)
+#  else
+#    define BEARBOT_API __declspec(dllimport)
+#  endif
+#else
+#  define BEARBOT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BEARBOT_API_VERSION 1
+
+typedef struct bearbot_engine bearbot_engine;
+
+/* Search limits, as in the UCI "go" command. -1 / 0 mean "not given". */
+typedef struct {
+	int depth;        /* plies, 0 = no depth limit */
+	uint64_t nodes;   /* 0 = no node limit */
+	int movetime;     /* milliseconds, 0 = none */
+	int wtime, btime; /* remaining clock in milliseconds, -1 = no clock */
+	int winc, binc;
+	int movestogo;    /* 0 = sudden death */
+	int infinite;     /* search until bearbot_stop */
+} bearbot_limits;
+
+typedef struct {
+	const char* best_move;   /* UCI notation, "0000" if there is no legal move */
+	const char* ponder_move; /* "" if unknown */
+	const char* pv;          /* space separated */
+	int score_cp;            /* centipawns from the side to move's point of view */
+	int mate;                /* moves to mate, negative if getting mated, 0 if no mate was found */
+	int depth;
+	uint64_t nodes;
+	int time_ms;
+} bearbot_result;
+
+typedef void (*bearbot_result_callback)(const bearbot_result* result, void* user_data);
+
+BEARBOT_API int bearbot_api_version(void);
+
+BEARBOT_API bearbot_engine* bearbot_engine_new(void);
+/* Stops a running search first. */
+BEARBOT_API void bearbot_engine_free(bearbot_engine* engine);
+
+/* position is "startpos" or a FEN, moves a space separated list of UCI moves (or NULL).
+ * Returns 0 if the FEN is invalid or a move is illegal. */
+BEARBOT_API int bearbot_set_position(bearbot_engine* engine, const char* position, const char* moves);
+BEARBOT_API void bearbot_new_game(bearbot_engine* engine);
+/* Search parameter by name, see SearchParams::set (nullmove, nmr, lmr, lmrdepth, lmrmoves). Returns 0 if unknown. */
+BEARBOT_API int bearbot_set_param(bearbot_engine* engine, const char* name, int value);
+
+BEARBOT_API void bearbot_limits_init(bearbot_limits* limits);
+
+/* Starts a background search. on_bestmove is called once at the end, on_info (may be NULL)
+ * after every finished iteration. Returns 0 if a search is already running. */
+BEARBOT_API int bearbot_go(bearbot_engine* engine, const bearbot_limits* limits, int ponder,
+                           bearbot_result_callback on_bestmove, bearbot_result_callback on_info, void* user_data);
+/* Searches on the calling thread and calls on_result with the outcome. */
+BEARBOT_API void bearbot_search(bearbot_engine* engine, const bearbot_limits* limits,
+                                bearbot_result_callback on_result, void* user_data);
+BEARBOT_API void bearbot_ponderhit(bearbot_engine* engine);
+/* Ends the running search and waits until its on_bestmove has returned. */
+BEARBOT_API void bearbot_stop(bearbot_engine* engine);
+BEARBOT_API void bearbot_wait(bearbot_engine* engine);
+BEARBOT_API int bearbot_is_searching(bearbot_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cctype>
+
+#include "epd.h"
+
+static std::string trim(const std::string& text) {
+	size_t start = text.find_first_not_of(" \t\r\n");
+	if (start == std::string::npos) {
+		return "";
+	}
+	size_t end = text.find_last_not_of(" \t\r\n");
+	return text.substr(start, end - start + 1);
+}
+
+static bool isNumber(const std::string& text) {
+	if (text.empty()) return false;
+	for (char ch : text) {
+		if (!isdigit(static_cast<unsigned char>(ch))) return false;
+	}
+	return true;
+}
+
+std::string EpdRecord::operation(const std::string& opcode) const {
+	for (const auto& op : operations) {
+		if (op.first == opcode) {
+			return op.second;
+		}
+	}
+	return "";
+}
+
+bool parseEpdLine(const std::string& line, EpdRecord& record) {
+	record = EpdRecord();
+	std::string text = trim(line);
+	if (text.empty() || text[0] == '#') {
+		return false;
+	}
+
+	// The first four fields are the position. FEN-style lines also carry the
+	// halfmove clock and fullmove number, which are kept when present.
+	std::stringstream ss(text);
+	std::vector<std::string> fields;
+	std::string field;
+	while (fields.size() < 6 && ss >> field) {
+		if (field.find(';') != std::string::npos) {
+			break;
+		}
+		fields.push_back(field);
+	}
+	if (fields.size() < 4) {
+		return false;
+	}
+	size_t fenFields = 4;
+	if (fields.size() == 6 && isNumber(fields[4]) && isNumber(fields[5])) {
+		fenFields = 6;
+	}
+	for (size_t i = 0; i < fenFields; i++) {
+		record.fen += (i > 0 ? " " : "") + fields[i];
+	}
+
+	// Everything after the position is a list of "opcode operand;" operations.
+	size_t pos = 0;
+	for (size_t i = 0; i < fenFields; i++) {
+		pos = text.find_first_not_of(" \t", pos);
+		pos = text.find_first_of(" \t", pos);
+	}
+	std::string rest = (pos == std::string::npos) ? "" : text.substr(pos);
+	std::stringstream ops(rest);
+	std::string op;
+	while (std::getline(ops, op, ';')) {
+		op = trim(op);
+		if (op.empty()) {
+			continue;
+		}
+		size_t split = op.find_first_of(" \t");
+		if (split == std::string::npos) {
+			record.operations.push_back({op, ""});
+		} else {
+			std::string operand = trim(op.substr(split));
+			if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"') {
+				operand = operand.substr(1, operand.size() - 2);
+			}
+			record.operations.push_back({op.substr(0, split), operand});
+		}
+	}
+	return true;
+}
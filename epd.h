@@ -0,0 +1,22 @@
+#ifndef EPD_H_
+#define EPD_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// One line of an EPD file: a position followed by ';'-separated operations, e.g.
+// "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ;D1 48 ;D2 2039"
+// "rnbqkb1r/pppppppp/5n2/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - bm e5; id \"test 1\";"
+struct EpdRecord {
+	std::string fen; // 4 field EPD position, plus the move clocks when the line had them
+	std::vector<std::pair<std::string, std::string>> operations; // opcode, operand
+
+	// Operand of the first operation with this opcode, or "" if there isn't one.
+	std::string operation(const std::string& opcode) const;
+};
+
+// Returns false for blank lines, comments ('#') and lines without a position.
+bool parseEpdLine(const std::string& line, EpdRecord& record);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef EVAL_PARAMS_H_
+#define EVAL_PARAMS_H_
+
+// Evaluation parameters in centipawns. "bearbot tune" writes a new version of this file (see tune.h).
+
+// pawn, knight, bishop, rook, queen, king. The king's value only has to dwarf everything
+// else, both sides always have one, so it is never tuned.
+const int PIECE_VALUES[6] = {100, 310, 320, 500, 900, 99999};
+
+// Bonus for a piece on a square, from white's point of view: square 0 is a8, 63 is h1.
+// Black pieces use the mirrored square (square ^ 56).
+const int PIECE_SQUARE[6][64] = {
+	{ // pawn
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	},
+	{ // knight
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	},
+	{ // bishop
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	},
+	{ // rook
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	},
+	{ // queen
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	},
+	{ // king
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0,
+		   0,   0,   0,   0,   0,   0,   0,   0
+	}
+};
+
+#endif
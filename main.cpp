@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "uci.h"
+#include "cpu.h"
+#include "batch.h"
+#include "match.h"
+#include "datagen.h"
+#include "tune.h"
+#include "server.h"
+#include "book.h"
+#include "trace.h"
+#include "numa.h"
+#include "endgame.h"
+
+int main(int argc, char* argv[]) {
+	// A binary built for a newer ISA level would die with an illegal instruction further down the line.
+	std::string missingFeatures;
+	if (!cpuSupportsBuild(missingFeatures)) {
+		std::cout << "info string this " << compiledArchName() << " build needs " << missingFeatures
+		          << ", which this CPU doesn't have. Use the generic build instead." << std::endl;
+		return 1;
+	}
+
+	// Options for every mode, e.g. "bearbot --affinity compact batch positions.epd"
+	int first = 1;
+	if (argc > 2 && std::string(argv[1]) == "--affinity") {
+		AffinityPolicy policy;
+		if (!parseAffinityPolicy(argv[2], policy)) {
+			std::cout << "Unknown affinity policy: " << argv[2] << " (auto, none, compact or spread)" << std::endl;
+			return 1;
+		}
+		setAffinityPolicy(policy);
+		first = 3;
+	}
+
+	// Built once up front so no search pays for it.
+	initEndgames();
+
+	// Command line modes, e.g. "bearbot batch positions.epd --depth 8"
+	if (argc > first) {
+		std::string mode = argv[first];
+		std::vector<std::string> args(argv + first + 1, argv + argc);
+		if (mode == "batch") {
+			return runBatch(args);
+		}
+		if (mode == "match") {
+			return runMatch(args);
+		}
+		if (mode == "datagen") {
+			return runDatagen(args);
+		}
+		if (mode == "tune") {
+			return runTune(args);
+		}
+		if (mode == "server") {
+			return runServer(args);
+		}
+		if (mode == "book") {
+			return runBook(args);
+		}
+		if (mode == "trace") {
+			return runTrace(args);
+		}
+		std::cout << "Unknown mode: " << mode << std::endl;
+		return 1;
+	}
+
+	return runUci();
+}
@@ -0,0 +1,278 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <random>
+
+#include "match.h"
+#include "board.h"
+#include "engine.h"
+#include "search.h"
+#include "epd.h"
+#include "numa.h"
+
+static const std::string START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Adjudication thresholds
+static const int RESIGN_SCORE = 1000;   // both engines agree one side is this far ahead...
+static const int RESIGN_MOVES = 4;      // ...for this many moves each
+static const int DRAW_SCORE = 10;       // both engines score the game within this...
+static const int DRAW_MOVES = 8;        // ...for this many moves each
+static const int DRAW_MIN_PLY = 80;     // ...after this many plies
+
+enum class GameResult { WHITE_WINS, BLACK_WINS, DRAW };
+
+static double eloToScore(double elo) {
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+double sprtLlr(int wins, int draws, int losses, double elo0, double elo1) {
+	int games = wins + draws + losses;
+	if (games == 0 || wins + losses == 0) {
+		return 0.0;
+	}
+	double n = games;
+	double score = (wins + 0.5 * draws) / n;
+	double variance = (wins * std::pow(1.0 - score, 2) + draws * std::pow(0.5 - score, 2) + losses * std::pow(score, 2)) / n;
+	if (variance <= 0) {
+		return 0.0;
+	}
+	double s0 = eloToScore(elo0);
+	double s1 = eloToScore(elo1);
+	return n * (s1 - s0) * (2 * score - s0 - s1) / (2 * variance);
+}
+
+// Random moves from fen that leave a game to play. Node-limited searches are deterministic,
+// so without these a game pair would replay the same two games every time it gets fen.
+static std::vector<std::string> randomOpening(const std::string& fen, int plies, uint64_t seed) {
+	std::mt19937_64 rng(seed);
+	for (int attempt = 0; attempt < 100; attempt++) {
+		Board board;
+		board.loadFen(fen);
+		std::vector<std::string> line;
+		std::vector<std::string> moves = generateLegalMoves(board);
+		while (static_cast<int>(line.size()) < plies && !moves.empty()) {
+			line.push_back(moves[rng() % moves.size()]);
+			board.pushMove(line.back());
+			moves = generateLegalMoves(board);
+		}
+		if (!moves.empty()) {
+			return line;
+		}
+	}
+	return {};
+}
+
+// Plays one game from fen after the opening moves. engineA plays white if aIsWhite.
+static GameResult playGame(const std::string& fen, const std::vector<std::string>& opening, bool aIsWhite,
+                           const SearchLimits& limits, const SearchParams& paramsA, const SearchParams& paramsB, int maxPlies) {
+	Board board;
+	board.loadFen(fen);
+	for (const std::string& move : opening) {
+		board.pushMove(move);
+	}
+	SearchContext white, black;
+	white.limits = black.limits = limits;
+	white.reportInfo = black.reportInfo = false;
+	white.params = aIsWhite ? paramsA : paramsB;
+	black.params = aIsWhite ? paramsB : paramsA;
+
+	std::vector<uint64_t> keys = {board.getKey()};
+	int winningStreak = 0; // consecutive moves where both sides agree on a decisive score, + for white
+	int drawStreak = 0;
+
+	for (int ply = 0; ply < maxPlies; ply++) {
+		PieceColor toMove = board.getCurrentPlayer();
+		std::vector<std::string> moves = generateLegalMoves(board);
+		if (moves.empty()) {
+			if (board.isInCheck(toMove)) {
+				return (toMove == PieceColor::WHITE) ? GameResult::BLACK_WINS : GameResult::WHITE_WINS;
+			}
+			return GameResult::DRAW;
+		}
+		if (board.getHalfmoveClock() >= 100 || board.hasInsufficientMaterial()
+		    || std::count(keys.begin(), keys.end(), board.getKey()) >= 3) {
+			return GameResult::DRAW;
+		}
+
+		SearchResult result = search(board, toMove == PieceColor::WHITE ? white : black);
+		int whiteScore = (toMove == PieceColor::WHITE) ? result.score : -result.score;
+
+		// Score based adjudication, it only kicks in when both engines agree.
+		if (whiteScore >= RESIGN_SCORE) {
+			winningStreak = (winningStreak > 0) ? winningStreak + 1 : 1;
+		} else if (whiteScore <= -RESIGN_SCORE) {
+			winningStreak = (winningStreak < 0) ? winningStreak - 1 : -1;
+		} else {
+			winningStreak = 0;
+		}
+		if (winningStreak >= 2 * RESIGN_MOVES) return GameResult::WHITE_WINS;
+		if (winningStreak <= -2 * RESIGN_MOVES) return GameResult::BLACK_WINS;
+		drawStreak = (std::abs(whiteScore) <= DRAW_SCORE) ? drawStreak + 1 : 0;
+		if (ply >= DRAW_MIN_PLY && drawStreak >= 2 * DRAW_MOVES) {
+			return GameResult::DRAW;
+		}
+
+		board.pushMove(result.bestMove);
+		keys.push_back(board.getKey());
+	}
+	return GameResult::DRAW;
+}
+
+static bool parseParams(const std::string& text, SearchParams& params) {
+	std::stringstream ss(text);
+	std::string pair;
+	while (std::getline(ss, pair, ',')) {
+		size_t eq = pair.find('=');
+		if (eq == std::string::npos || !params.set(pair.substr(0, eq), std::atoi(pair.c_str() + eq + 1))) {
+			std::cerr << "Bad search parameter: " << pair << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int runMatch(const std::vector<std::string>& args) {
+	std::string openingsPath;
+	int maxGames = 1000;
+	int threadCount = 0;
+	int maxPlies = 400;
+	int randomPlies = 8;
+	uint64_t seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	double elo0 = 0, elo1 = 10, alpha = 0.05, beta = 0.05;
+	SearchLimits limits;
+	limits.depth = MAX_PLY - 1;
+	limits.nodes = 20000;
+	SearchParams paramsA, paramsB;
+
+	for (size_t i = 0; i < args.size(); i++) {
+		if (i + 1 >= args.size()) {
+			std::cerr << "Missing value for " << args[i] << std::endl;
+			return 1;
+		}
+		const std::string& option = args[i];
+		const std::string& value = args[++i];
+		if (option == "--openings") openingsPath = value;
+		else if (option == "--games") maxGames = std::atoi(value.c_str());
+		else if (option == "--threads") threadCount = std::atoi(value.c_str());
+		else if (option == "--maxplies") maxPlies = std::atoi(value.c_str());
+		else if (option == "--randomplies") randomPlies = std::max(0, std::atoi(value.c_str()));
+		else if (option == "--seed") seed = std::strtoull(value.c_str(), nullptr, 10);
+		else if (option == "--nodes") { limits.nodes = std::strtoull(value.c_str(), nullptr, 10); }
+		else if (option == "--movetime") { limits.movetime = std::atoi(value.c_str()); limits.nodes = 0; }
+		else if (option == "--depth") { limits.depth = std::atoi(value.c_str()); limits.nodes = 0; }
+		else if (option == "--elo0") elo0 = std::atof(value.c_str());
+		else if (option == "--elo1") elo1 = std::atof(value.c_str());
+		else if (option == "--alpha") alpha = std::atof(value.c_str());
+		else if (option == "--beta") beta = std::atof(value.c_str());
+		else if (option == "--a") { if (!parseParams(value, paramsA)) return 1; }
+		else if (option == "--b") { if (!parseParams(value, paramsB)) return 1; }
+		else {
+			std::cerr << "Unknown match option: " << option << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<std::string> openings;
+	if (!openingsPath.empty()) {
+		std::ifstream file(openingsPath);
+		if (!file) {
+			std::cerr << "Can't open " << openingsPath << std::endl;
+			return 1;
+		}
+		std::string line;
+		EpdRecord record;
+		Board check;
+		while (std::getline(file, line)) {
+			if (parseEpdLine(line, record) && check.loadFen(record.fen)) {
+				openings.push_back(record.fen);
+			}
+		}
+	}
+	if (openings.empty()) {
+		openings.push_back(START_FEN);
+	}
+	if (threadCount < 1) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	// Without random moves every pair past the last opening repeats an earlier one, and the
+	// SPRT would count the repeats as new evidence.
+	if (randomPlies == 0 && maxGames > 2 * static_cast<int>(openings.size())) {
+		maxGames = 2 * static_cast<int>(openings.size());
+		std::cout << "Only " << openings.size() << " distinct openings and no random plies: stopping after "
+		          << maxGames << " games" << std::endl;
+	}
+
+	const double lowerBound = std::log(beta / (1 - alpha));
+	const double upperBound = std::log((1 - beta) / alpha);
+	std::cout << "Match: " << openings.size() << " openings, " << randomPlies << " random plies, up to " << maxGames << " games, "
+	          << threadCount << " threads, SPRT elo0 " << elo0 << " elo1 " << elo1
+	          << " bounds [" << lowerBound << ", " << upperBound << "]" << std::endl;
+
+	std::mutex mutex;
+	std::atomic<int> nextGame(0);
+	std::atomic<bool> decided(false);
+	int wins = 0, draws = 0, losses = 0; // from engine A's point of view
+	double llr = 0;
+
+	auto worker = [&](int workerIndex) {
+		pinWorkerThread(workerIndex);
+		while (!decided) {
+			int game = nextGame++;
+			if (game >= maxGames) {
+				return;
+			}
+			// Game pairs: the same opening with the colors swapped
+			int pair = game / 2;
+			const std::string& fen = openings[pair % openings.size()];
+			std::vector<std::string> opening = randomOpening(fen, randomPlies, seed + pair * 0x9E3779B97F4A7C15ULL);
+			bool aIsWhite = (game % 2) == 0;
+			GameResult result = playGame(fen, opening, aIsWhite, limits, paramsA, paramsB, maxPlies);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decided) {
+				return;
+			}
+			if (result == GameResult::DRAW) draws++;
+			else if ((result == GameResult::WHITE_WINS) == aIsWhite) wins++;
+			else losses++;
+
+			int games = wins + draws + losses;
+			double score = (wins + 0.5 * draws) / games;
+			double elo = (score > 0 && score < 1) ? -400.0 * std::log10(1.0 / score - 1.0) : (score >= 1 ? 999 : -999);
+			if (std::abs(elo) < 1e-9) elo = 0; // no "-0"
+			llr = sprtLlr(wins, draws, losses, elo0, elo1);
+			std::cout << "Games: " << games << " W: " << wins << " L: " << losses << " D: " << draws
+			          << " Score: " << 100.0 * score << "% Elo: " << elo << " LLR: " << llr << std::endl;
+			if (llr >= upperBound || llr <= lowerBound) {
+				decided = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.emplace_back(worker, t);
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	if (llr >= upperBound) {
+		std::cout << "SPRT: H1 accepted, A is stronger (elo >= " << elo1 << ")" << std::endl;
+	} else if (llr <= lowerBound) {
+		std::cout << "SPRT: H0 accepted, A is not stronger (elo <= " << elo0 << ")" << std::endl;
+	} else {
+		std::cout << "SPRT: no decision after " << (wins + draws + losses) << " games" << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MATCH_H_
+#define MATCH_H_
+
+#include <string>
+#include <vector>
+
+// Self-play match between two engine configurations: "bearbot match [options]"
+//
+//   --openings FILE     EPD file of start positions, each played once with either color
+//                       (default: the start position)
+//   --randomplies N     random moves played from the opening before each game pair
+//                       (default 8). With 0 the match stops after two games per opening
+//   --seed N            seed of the random moves (default: from the clock)
+//   --games N           stop after N games if the SPRT hasn't decided (default 1000)
+//   --threads N         games played at once (default: all cores)
+//   --nodes N | --movetime MS | --depth N
+//                       search limit per move (default --nodes 20000)
+//   --a k=v,k=v         search parameters of engine A, see SearchParams::set
+//   --b k=v,k=v         search parameters of engine B
+//   --elo0 E --elo1 E   SPRT hypotheses in Elo (default 0 and 10)
+//   --alpha A --beta B  SPRT error rates (default 0.05 each)
+//   --maxplies N        adjudicate a draw after N plies (default 400)
+//
+// Prints a running W-L-D / Elo / LLR line from A's point of view and stops as soon
+// as the SPRT accepts either hypothesis.
+int runMatch(const std::vector<std::string>& args);
+
+// Log-likelihood ratio of "A is elo1 stronger" over "A is elo0 stronger" for a
+// win/draw/loss result, using the normal approximation of the trinomial GSPRT.
+double sprtLlr(int wins, int draws, int losses, double elo0, double elo1);
+
+#endif
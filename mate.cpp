@@ -0,0 +1,257 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+#include "mate.h"
+#include "engine.h"
+
+static const uint32_t PN_INFINITY = 1000000000;
+
+static uint32_t addCapped(uint32_t a, uint32_t b) {
+	return std::min<uint64_t>(static_cast<uint64_t>(a) + b, PN_INFINITY);
+}
+
+// One position of the proof tree. Attacker nodes (even ply) are OR nodes: proving one
+// child proves them. Defender nodes (odd ply) are AND nodes: every child has to be proven.
+struct PnNode {
+	uint32_t proof = 1;
+	uint32_t disproof = 1;
+	int32_t parent = -1;
+	int32_t firstChild = -1; // children are stored next to each other
+	uint16_t childCount = 0;
+	uint8_t ply = 0;
+	bool expanded = false;
+	char move[6] = {};       // the UCI move that leads here from the parent
+};
+
+class ProofNumberSearch {
+public:
+	ProofNumberSearch(Board& board, int moves, uint64_t maxNodes)
+		: board(board), maxPly(2 * moves - 1), maxNodes(maxNodes), attacker(board.getCurrentPlayer()) {}
+
+	// Returns the root's status: proven, disproven, or unknown (out of nodes or stopped).
+	bool run(SearchContext& context, bool& outOfNodes) {
+		nodes.reserve(std::min<uint64_t>(maxNodes, 1 << 16));
+		nodes.push_back(PnNode());
+		setStatus(0);
+		outOfNodes = false;
+		uint64_t iterations = 0;
+		while (nodes[0].proof != 0 && nodes[0].disproof != 0) {
+			if ((++iterations & 1023) == 0 && context.stopRequested) {
+				return false;
+			}
+			int node = selectMostProving();
+			if (!expand(node)) {
+				outOfNodes = true;
+				unwind(node);
+				return false;
+			}
+			update(node);
+		}
+		return nodes[0].proof == 0;
+	}
+
+	uint64_t nodeCount() const { return nodes.size(); }
+
+	// The mating line through the proof tree: the attacker takes the fastest mate,
+	// the defender the slowest. Returns the mate length in plies.
+	int mateLine(std::vector<std::string>& line) {
+		line.clear();
+		int length = mateLength(0);
+		int node = 0;
+		while (nodes[node].childCount > 0) {
+			const PnNode& parent = nodes[node];
+			bool attackerToMove = parent.ply % 2 == 0;
+			int best = -1, bestLength = 0;
+			for (int c = parent.firstChild; c < parent.firstChild + parent.childCount; c++) {
+				if (nodes[c].proof != 0) {
+					continue;
+				}
+				int childLength = mateLength(c);
+				if (best == -1 || (attackerToMove ? childLength < bestLength : childLength > bestLength)) {
+					best = c;
+					bestLength = childLength;
+				}
+			}
+			if (best == -1) {
+				break;
+			}
+			line.push_back(nodes[best].move);
+			node = best;
+		}
+		return length;
+	}
+
+private:
+	bool attackerToMove(const PnNode& node) const { return node.ply % 2 == 0; }
+
+	// Legal moves worth trying here: checks for the attacker, everything for the defender.
+	std::vector<std::string> candidateMoves(const PnNode& node) {
+		std::vector<std::string> moves = generateLegalMoves(board);
+		if (!attackerToMove(node)) {
+			return moves;
+		}
+		PieceColor defender = (attacker == PieceColor::WHITE) ? PieceColor::BLACK : PieceColor::WHITE;
+		std::vector<std::string> checks;
+		for (const std::string& move : moves) {
+			board.pushMove(move);
+			if (board.isInCheck(defender)) {
+				checks.push_back(move);
+			}
+			board.popMove(move);
+		}
+		return checks;
+	}
+
+	// Sets the proof and disproof numbers of a fresh leaf; board is at the leaf's position.
+	void setStatus(int index) {
+		PnNode& node = nodes[index];
+		if (!attackerToMove(node)) {
+			std::vector<std::string> moves = generateLegalMoves(board);
+			if (moves.empty()) {
+				bool mate = board.isInCheck(board.getCurrentPlayer());
+				node.proof = mate ? 0 : PN_INFINITY;
+				node.disproof = mate ? PN_INFINITY : 0;
+			} else if (node.ply >= maxPly) {
+				node.proof = PN_INFINITY; // out of moves
+				node.disproof = 0;
+			} else {
+				// More evasions, more to prove
+				node.proof = static_cast<uint32_t>(moves.size());
+				node.disproof = 1;
+			}
+		} else {
+			std::vector<std::string> checks = (node.ply < maxPly) ? candidateMoves(node) : std::vector<std::string>();
+			if (checks.empty()) {
+				node.proof = PN_INFINITY;
+				node.disproof = 0;
+			} else {
+				node.proof = 1;
+				node.disproof = static_cast<uint32_t>(checks.size());
+			}
+		}
+	}
+
+	// Walks down from the root to the leaf that proves or disproves the most, playing the moves on the board.
+	int selectMostProving() {
+		int node = 0;
+		while (nodes[node].expanded) {
+			const PnNode& parent = nodes[node];
+			int best = parent.firstChild;
+			for (int c = parent.firstChild + 1; c < parent.firstChild + parent.childCount; c++) {
+				if (attackerToMove(parent) ? nodes[c].proof < nodes[best].proof : nodes[c].disproof < nodes[best].disproof) {
+					best = c;
+				}
+			}
+			board.pushMove(nodes[best].move);
+			node = best;
+		}
+		return node;
+	}
+
+	bool expand(int index) {
+		std::vector<std::string> moves = candidateMoves(nodes[index]);
+		if (nodes.size() + moves.size() > maxNodes) {
+			return false;
+		}
+		int first = static_cast<int>(nodes.size());
+		uint8_t childPly = nodes[index].ply + 1;
+		for (const std::string& move : moves) {
+			PnNode child;
+			child.parent = index;
+			child.ply = childPly;
+			std::strncpy(child.move, move.c_str(), sizeof(child.move) - 1);
+			nodes.push_back(child);
+			board.pushMove(move);
+			setStatus(static_cast<int>(nodes.size()) - 1);
+			board.popMove(move);
+		}
+		PnNode& node = nodes[index];
+		node.firstChild = first;
+		node.childCount = static_cast<uint16_t>(moves.size());
+		node.expanded = true;
+		return true;
+	}
+
+	// Recomputes the numbers from node up to the root, taking the moves back on the way.
+	void update(int index) {
+		while (index >= 0) {
+			PnNode& node = nodes[index];
+			if (attackerToMove(node)) {
+				uint32_t proof = PN_INFINITY, disproof = 0;
+				for (int c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+					proof = std::min(proof, nodes[c].proof);
+					disproof = addCapped(disproof, nodes[c].disproof);
+				}
+				node.proof = proof;
+				node.disproof = disproof;
+			} else {
+				uint32_t proof = 0, disproof = PN_INFINITY;
+				for (int c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+					proof = addCapped(proof, nodes[c].proof);
+					disproof = std::min(disproof, nodes[c].disproof);
+				}
+				node.proof = proof;
+				node.disproof = disproof;
+			}
+			if (node.parent >= 0) {
+				board.popMove(node.move);
+			}
+			index = node.parent;
+		}
+	}
+
+	void unwind(int index) {
+		while (nodes[index].parent >= 0) {
+			board.popMove(nodes[index].move);
+			index = nodes[index].parent;
+		}
+	}
+
+	// Plies to mate from a proven node.
+	int mateLength(int index) {
+		const PnNode& node = nodes[index];
+		if (node.childCount == 0) {
+			return 0;
+		}
+		int length = attackerToMove(node) ? PN_INFINITY : 0;
+		for (int c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+			if (nodes[c].proof != 0) {
+				continue;
+			}
+			int childLength = 1 + mateLength(c);
+			length = attackerToMove(node) ? std::min(length, childLength) : std::max(length, childLength);
+		}
+		return length;
+	}
+
+	Board& board;
+	const int maxPly;
+	const uint64_t maxNodes;
+	const PieceColor attacker;
+	std::vector<PnNode> nodes;
+};
+
+bool findMate(Board& board, int moves, uint64_t maxNodes, SearchContext& context, SearchResult& result, bool& stopped) {
+	moves = std::max(1, std::min(moves, (MAX_PLY - 1) / 2));
+	auto start = std::chrono::steady_clock::now();
+	ProofNumberSearch pns(board, moves, maxNodes);
+	bool outOfNodes = false;
+	bool proven = pns.run(context, outOfNodes);
+	stopped = !proven && !outOfNodes && context.stopRequested;
+	result.nodes = pns.nodeCount();
+	result.timeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	if (!proven) {
+		return false;
+	}
+
+	std::vector<std::string> line;
+	int plies = pns.mateLine(line);
+	result.pv = line;
+	result.bestMove = line.empty() ? "" : line[0];
+	result.depth = plies;
+	result.score = MATE_SCORE - plies;
+	return !line.empty();
+}
@@ -0,0 +1,19 @@
+#ifndef MATE_H_
+#define MATE_H_
+
+#include <cstdint>
+#include "board.h"
+#include "search.h"
+
+const uint64_t MATE_SEARCH_MAX_NODES = 1 << 22; // default size of the node table, about 28 bytes a node
+
+// "go mate N": proof-number search for a forced mate in at most N moves by the side to move.
+//
+// The tree is kept in a node table that grows up to maxNodes entries. The attacker only
+// tries moves that give check, the defender tries every legal move, and a line is given
+// up once it runs past N moves. On success result holds the mating line and a mate score
+// and true is returned. False means there is no mate in N, or the table filled up, or the
+// search was stopped first (stopped is set then).
+bool findMate(Board& board, int moves, uint64_t maxNodes, SearchContext& context, SearchResult& result, bool& stopped);
+
+#endif
@@ -0,0 +1,262 @@
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+
+#include "numa.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+static std::atomic<AffinityPolicy> currentPolicy(AffinityPolicy::AUTO);
+
+#ifdef __linux__
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+static std::vector<int> parseCpuList(const std::string& list) {
+	std::vector<int> cpus;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range[0] < '0' || range[0] > '9') {
+			continue;
+		}
+		size_t dash = range.find('-');
+		int first = std::atoi(range.c_str());
+		int last = (dash == std::string::npos) ? first : std::atoi(range.c_str() + dash + 1);
+		for (int cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+static std::vector<NumaNode> detectNodes() {
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool haveMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+	auto isAllowed = [&](int cpu) {
+		return !haveMask || (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed));
+	};
+
+	std::vector<NumaNode> nodes;
+	std::ifstream online("/sys/devices/system/node/online");
+	std::string nodeList;
+	if (online && std::getline(online, nodeList)) {
+		for (int id : parseCpuList(nodeList)) {
+			std::ifstream cpuList("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+			std::string list;
+			if (!cpuList || !std::getline(cpuList, list)) {
+				continue;
+			}
+			NumaNode node;
+			node.id = id;
+			for (int cpu : parseCpuList(list)) {
+				if (isAllowed(cpu)) {
+					node.cpus.push_back(cpu);
+				}
+			}
+			if (!node.cpus.empty()) { // memory-only nodes have nothing to pin to
+				nodes.push_back(node);
+			}
+		}
+	}
+
+	// No NUMA support in the kernel (or no sysfs): one node with every allowed CPU.
+	if (nodes.empty()) {
+		NumaNode node;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (haveMask && CPU_ISSET(cpu, &allowed)) {
+				node.cpus.push_back(cpu);
+			}
+		}
+		nodes.push_back(node);
+	}
+	return nodes;
+}
+
+#else
+
+static std::vector<NumaNode> detectNodes() {
+	return std::vector<NumaNode>(1);
+}
+
+#endif
+
+const std::vector<NumaNode>& numaNodes() {
+	static const std::vector<NumaNode> nodes = detectNodes();
+	return nodes;
+}
+
+std::string numaTopologyString() {
+	const std::vector<NumaNode>& nodes = numaNodes();
+	std::string text = std::to_string(nodes.size()) + (nodes.size() == 1 ? " node:" : " nodes:");
+	for (const NumaNode& node : nodes) {
+		text += " " + std::to_string(node.id) + " (";
+		if (node.cpus.empty()) {
+			text += "cpus unknown)";
+			continue;
+		}
+		text += "cpus ";
+		// Back to ranges
+		for (size_t i = 0; i < node.cpus.size(); i++) {
+			size_t j = i;
+			while (j + 1 < node.cpus.size() && node.cpus[j + 1] == node.cpus[j] + 1) {
+				j++;
+			}
+			text += (i > 0 ? "," : "") + std::to_string(node.cpus[i]);
+			if (j > i) {
+				text += "-" + std::to_string(node.cpus[j]);
+			}
+			i = j;
+		}
+		text += ")";
+	}
+	return text;
+}
+
+bool parseAffinityPolicy(const std::string& name, AffinityPolicy& policy) {
+	if (name == "auto") policy = AffinityPolicy::AUTO;
+	else if (name == "none") policy = AffinityPolicy::NONE;
+	else if (name == "compact") policy = AffinityPolicy::COMPACT;
+	else if (name == "spread") policy = AffinityPolicy::SPREAD;
+	else return false;
+	return true;
+}
+
+const char* affinityPolicyName(AffinityPolicy policy) {
+	switch (policy) {
+	case AffinityPolicy::AUTO: return "auto";
+	case AffinityPolicy::NONE: return "none";
+	case AffinityPolicy::COMPACT: return "compact";
+	case AffinityPolicy::SPREAD: return "spread";
+	}
+	return "auto";
+}
+
+void setAffinityPolicy(AffinityPolicy policy) {
+	currentPolicy = policy;
+}
+
+AffinityPolicy affinityPolicy() {
+	return currentPolicy;
+}
+
+int pinWorkerThread(int workerIndex) {
+#ifdef __linux__
+	const std::vector<NumaNode>& nodes = numaNodes();
+	AffinityPolicy policy = currentPolicy;
+	if (policy == AffinityPolicy::AUTO) {
+		policy = (nodes.size() > 1) ? AffinityPolicy::SPREAD : AffinityPolicy::NONE;
+	}
+	if (policy == AffinityPolicy::NONE || workerIndex < 0) {
+		return -1;
+	}
+
+	const NumaNode* node = nullptr;
+	int cpu = -1;
+	if (policy == AffinityPolicy::SPREAD) {
+		node = &nodes[workerIndex % nodes.size()];
+		if (!node->cpus.empty()) {
+			cpu = node->cpus[(workerIndex / nodes.size()) % node->cpus.size()];
+		}
+	} else {
+		size_t total = 0;
+		for (const NumaNode& n : nodes) {
+			total += n.cpus.size();
+		}
+		if (total > 0) {
+			size_t index = workerIndex % total;
+			for (const NumaNode& n : nodes) {
+				if (index < n.cpus.size()) {
+					node = &n;
+					cpu = n.cpus[index];
+					break;
+				}
+				index -= n.cpus.size();
+			}
+		}
+	}
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		return -1;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		return -1;
+	}
+	return node->id;
+#else
+	(void)workerIndex;
+	return -1;
+#endif
+}
+
+#if defined(__linux__) && defined(SYS_mbind)
+
+static bool interleaveWorthIt(size_t bytes) {
+	return bytes >= INTERLEAVE_MIN_BYTES && numaNodes().size() > 1;
+}
+
+static size_t roundToPages(size_t bytes) {
+	size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return (bytes + page - 1) / page * page;
+}
+
+void* allocateInterleaved(size_t bytes) {
+	if (!interleaveWorthIt(bytes)) {
+		return ::operator new(bytes, std::nothrow);
+	}
+	size_t length = roundToPages(bytes);
+	void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return nullptr;
+	}
+
+	// No libnuma: mbind(MPOL_INTERLEAVE) straight through the system call. Nothing is touched
+	// yet, so every page lands on the next node when it's first written. If the kernel says
+	// no, the memory is still good, just placed by first touch.
+	const int MPOL_INTERLEAVE_MODE = 3;
+	const size_t maskBits = 1024;
+	unsigned long mask[maskBits / (8 * sizeof(unsigned long))] = {};
+	for (const NumaNode& node : numaNodes()) {
+		if (node.id >= 0 && static_cast<size_t>(node.id) < maskBits) {
+			mask[node.id / (8 * sizeof(unsigned long))] |= 1UL << (node.id % (8 * sizeof(unsigned long)));
+		}
+	}
+	syscall(SYS_mbind, memory, length, MPOL_INTERLEAVE_MODE, mask, maskBits + 1, 0);
+	return memory;
+}
+
+void freeInterleaved(void* memory, size_t bytes) {
+	if (!memory) {
+		return;
+	}
+	if (!interleaveWorthIt(bytes)) {
+		::operator delete(memory);
+		return;
+	}
+	munmap(memory, roundToPages(bytes));
+}
+
+#else
+
+void* allocateInterleaved(size_t bytes) {
+	return ::operator new(bytes, std::nothrow);
+}
+
+void freeInterleaved(void* memory, size_t) {
+	::operator delete(memory);
+}
+
+#endif
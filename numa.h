@@ -0,0 +1,77 @@
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <new>
+
+// Where worker threads run and where their memory lives on multi-socket machines.
+//
+// The topology comes from /sys/devices/system/node (Linux only), limited to the CPUs this
+// process may run on. Workers pin themselves with pinWorkerThread before they allocate
+// anything, so their boards, search state and eval caches are first touched, and therefore
+// placed, on their own node. Big tables that every worker reads use InterleavedAllocator,
+// which spreads their pages over all nodes so no single memory controller serves them all.
+// Elsewhere, and on single-node machines with the default policy, all of this does nothing.
+
+enum class AffinityPolicy {
+	AUTO,    // SPREAD when there is more than one node, NONE otherwise (default)
+	NONE,    // leave placement to the scheduler
+	COMPACT, // worker i on the i-th allowed CPU, filling one node before the next
+	SPREAD   // workers dealt round robin over the nodes, then over each node's CPUs
+};
+
+struct NumaNode {
+	int id = 0;
+	std::vector<int> cpus;
+};
+
+// The nodes that have CPUs this process may use. Always at least one.
+const std::vector<NumaNode>& numaNodes();
+std::string numaTopologyString(); // "2 nodes: 0 (cpus 0-15) 1 (cpus 16-31)"
+
+bool parseAffinityPolicy(const std::string& name, AffinityPolicy& policy); // auto, none, compact, spread
+const char* affinityPolicyName(AffinityPolicy policy);
+void setAffinityPolicy(AffinityPolicy policy);
+AffinityPolicy affinityPolicy();
+
+// Pins the calling thread to the CPU the policy gives worker workerIndex. Returns the
+// node it now runs on, or -1 if it wasn't pinned.
+int pinWorkerThread(int workerIndex);
+
+// Blocks of at least this size are interleaved, smaller ones come from operator new.
+const size_t INTERLEAVE_MIN_BYTES = 2 * 1024 * 1024;
+
+// Memory with its pages spread round robin over all nodes (plain memory on a single node).
+// Only the size decides how a block was allocated, so freeInterleaved needs the same size.
+void* allocateInterleaved(size_t bytes);
+void freeInterleaved(void* memory, size_t bytes);
+
+// For std::vector of a large table that all workers share.
+template <typename T>
+struct InterleavedAllocator {
+	typedef T value_type;
+
+	InterleavedAllocator() = default;
+	template <typename U>
+	InterleavedAllocator(const InterleavedAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		void* memory = allocateInterleaved(n * sizeof(T));
+		if (!memory) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(memory);
+	}
+	void deallocate(T* memory, size_t n) {
+		freeInterleaved(memory, n * sizeof(T));
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const InterleavedAllocator<T>&, const InterleavedAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const InterleavedAllocator<T>&, const InterleavedAllocator<U>&) { return false; }
+
+#endif
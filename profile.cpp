@@ -0,0 +1,106 @@
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "profile.h"
+#include "search.h"
+
+static const char* const PROFILE_ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+	"movegen", "legal filter", "pushMove", "popMove", "isSquareAttacked", "evaluatePosition"
+};
+
+#ifdef BEARBOT_PROFILE
+
+thread_local ProfileCounters profileCounters;
+thread_local ProfileScope* profileCurrentScope = nullptr;
+
+struct ProfileTotals {
+	uint64_t calls[PROFILE_ZONE_COUNT] = {};
+	uint64_t selfCycles[PROFILE_ZONE_COUNT] = {};
+	uint64_t totalCycles[PROFILE_ZONE_COUNT] = {};
+
+	void add(const ProfileCounters& counters) {
+		for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+			calls[z] += counters.calls[z].load(std::memory_order_relaxed);
+			selfCycles[z] += counters.selfCycles[z].load(std::memory_order_relaxed);
+			totalCycles[z] += counters.totalCycles[z].load(std::memory_order_relaxed);
+		}
+	}
+};
+
+static std::mutex profileMutex;                    // guards the three below
+static std::vector<ProfileCounters*> liveThreads;
+static ProfileTotals finishedThreads;              // counts of threads that have exited
+static ProfileTotals lastPrinted;
+
+// Lives as long as its thread, hands the thread's counts over when it exits.
+struct ProfileRegistration {
+	ProfileRegistration() {
+		std::lock_guard<std::mutex> lock(profileMutex);
+		liveThreads.push_back(&profileCounters);
+		profileCounters.registered = true;
+	}
+	~ProfileRegistration() {
+		std::lock_guard<std::mutex> lock(profileMutex);
+		finishedThreads.add(profileCounters);
+		liveThreads.erase(std::find(liveThreads.begin(), liveThreads.end(), &profileCounters));
+	}
+};
+
+void registerProfileThread() {
+	static thread_local ProfileRegistration registration;
+	(void)registration;
+}
+
+void printProfile() {
+	ProfileTotals now;
+	size_t threads;
+	{
+		std::lock_guard<std::mutex> lock(profileMutex);
+		now = finishedThreads;
+		for (const ProfileCounters* counters : liveThreads) {
+			now.add(*counters);
+		}
+		threads = liveThreads.size();
+		std::swap(now, lastPrinted);
+		// now is the previous snapshot, lastPrinted the current one
+		for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+			now.calls[z] = lastPrinted.calls[z] - now.calls[z];
+			now.selfCycles[z] = lastPrinted.selfCycles[z] - now.selfCycles[z];
+			now.totalCycles[z] = lastPrinted.totalCycles[z] - now.totalCycles[z];
+		}
+	}
+
+	uint64_t total = 0;
+	for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+		total += now.selfCycles[z];
+	}
+#ifdef BEARBOT_PROFILE_RDTSC
+	const char* unit = "cycles";
+#else
+	const char* unit = "ns";
+#endif
+	std::ostringstream out;
+	out << "info string profile " << total << " " << unit << " in profiled code, " << threads << " threads running";
+	for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+		uint64_t calls = now.calls[z];
+		out << "\ninfo string profile " << std::left << std::setw(17) << PROFILE_ZONE_NAMES[z] << std::right
+		    << " calls " << std::setw(12) << calls
+		    << " self " << std::fixed << std::setprecision(1) << std::setw(5) << (total > 0 ? 100.0 * now.selfCycles[z] / total : 0.0) << "%"
+		    << " " << std::setw(8) << (calls > 0 ? static_cast<double>(now.selfCycles[z]) / calls : 0.0) << " " << unit << "/call"
+		    << " incl " << std::setw(8) << (calls > 0 ? static_cast<double>(now.totalCycles[z]) / calls : 0.0) << " " << unit << "/call"
+		    << std::defaultfloat;
+	}
+	uciWrite(out.str());
+}
+
+#else
+
+void printProfile() {
+	(void)PROFILE_ZONE_NAMES;
+	uciWrite("info string profiling is compiled out, configure with -DBEARBOT_PROFILE=ON");
+}
+
+#endif
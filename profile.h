@@ -0,0 +1,108 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <cstdint>
+
+// Cycle counting around the hot board and movegen functions, for finding out which of them
+// made the engine slower. Off by default: configure with -DBEARBOT_PROFILE=ON to build it in.
+// Compiled out, BEARBOT_PROFILE_SCOPE expands to nothing.
+//
+// Every thread counts calls and timestamp counter cycles in its own counters, nobody else
+// writes them. A zone's "self" cycles leave out the zones it calls (generateLegalMoves
+// without the pushMove/popMove/isSquareAttacked it does), so the self column adds up to
+// the profiled total. The "profile" UCI command prints what was counted since the last one.
+enum ProfileZone {
+	PROFILE_MOVEGEN,          // generatePseudoLegalMoves
+	PROFILE_LEGAL,            // generateLegalMoves
+	PROFILE_PUSH_MOVE,
+	PROFILE_POP_MOVE,
+	PROFILE_SQUARE_ATTACKED,
+	PROFILE_EVALUATE,         // evaluatePosition
+	PROFILE_ZONE_COUNT
+};
+
+// Prints the counts of all threads (those still running and those that have finished)
+// since the last call, as "info string profile ..." lines.
+void printProfile();
+
+#ifdef BEARBOT_PROFILE
+
+#include <atomic>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BEARBOT_PROFILE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BEARBOT_PROFILE_RDTSC 1
+#else
+#include <chrono>
+#endif
+
+inline uint64_t readCycles() {
+#ifdef BEARBOT_PROFILE_RDTSC
+	return __rdtsc();
+#else
+	// No timestamp counter: nanoseconds instead
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Atomic only so printProfile can read them while the thread runs. Only the owning thread
+// writes, with plain loads and stores, so there's no locked instruction on the hot path.
+struct ProfileCounters {
+	std::atomic<uint64_t> calls[PROFILE_ZONE_COUNT];
+	std::atomic<uint64_t> selfCycles[PROFILE_ZONE_COUNT];
+	std::atomic<uint64_t> totalCycles[PROFILE_ZONE_COUNT];
+	bool registered;
+};
+
+class ProfileScope;
+extern thread_local ProfileCounters profileCounters;
+extern thread_local ProfileScope* profileCurrentScope;
+void registerProfileThread();
+
+inline void profileAdd(std::atomic<uint64_t>& counter, uint64_t amount) {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+class ProfileScope {
+public:
+	explicit ProfileScope(ProfileZone zone) : zone(zone), parent(profileCurrentScope) {
+		if (!profileCounters.registered) {
+			registerProfileThread();
+		}
+		profileCurrentScope = this;
+		start = readCycles();
+	}
+
+	~ProfileScope() {
+		uint64_t elapsed = readCycles() - start;
+		profileCurrentScope = parent;
+		if (parent) {
+			parent->childCycles += elapsed;
+		}
+		profileAdd(profileCounters.calls[zone], 1);
+		profileAdd(profileCounters.selfCycles[zone], elapsed - childCycles);
+		profileAdd(profileCounters.totalCycles[zone], elapsed);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	ProfileZone zone;
+	ProfileScope* parent;
+	uint64_t start = 0;
+	uint64_t childCycles = 0;
+};
+
+#define BEARBOT_PROFILE_SCOPE(zone) ProfileScope profileScope(zone)
+
+#else
+
+#define BEARBOT_PROFILE_SCOPE(zone) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,734 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+
+#include "search.h"
+#include "engine.h"
+#include "board.h"
+#include "mate.h"
+#include "endgame.h"
+#include "eval_params.h"
+
+void SearchStats::add(const SearchStats& other) {
+	nodes += other.nodes;
+	qnodes += other.qnodes;
+	betaCutoffs += other.betaCutoffs;
+	firstMoveCutoffs += other.firstMoveCutoffs;
+	nullMoveTries += other.nullMoveTries;
+	nullMoveCutoffs += other.nullMoveCutoffs;
+	lmrReductions += other.lmrReductions;
+	lmrResearches += other.lmrResearches;
+	drawCutoffs += other.drawCutoffs;
+	evalCacheProbes += other.evalCacheProbes;
+	evalCacheHits += other.evalCacheHits;
+	searchCacheProbes += other.searchCacheProbes;
+	searchCacheCutoffs += other.searchCacheCutoffs;
+	seldepth = std::max(seldepth, other.seldepth);
+}
+
+bool SearchParams::set(const std::string& name, int value) {
+	if (name == "nullmove") nullMove = value != 0;
+	else if (name == "nmr") nullMoveReduction = value;
+	else if (name == "lmr") lmr = value != 0;
+	else if (name == "lmrdepth") lmrMinDepth = value;
+	else if (name == "lmrmoves") lmrMinMoveIndex = value;
+	else return false;
+	return true;
+}
+
+bool EvalCache::probe(uint64_t key, int& eval) const {
+	if (entries.empty()) {
+		return false;
+	}
+	const Entry& entry = entries[key & (EVAL_CACHE_ENTRIES - 1)];
+	if (entry.key != key) {
+		return false;
+	}
+	eval = entry.eval;
+	return true;
+}
+
+void EvalCache::store(uint64_t key, int eval) {
+	if (entries.empty()) {
+		entries.resize(EVAL_CACHE_ENTRIES);
+	}
+	Entry& entry = entries[key & (EVAL_CACHE_ENTRIES - 1)];
+	entry.key = key;
+	entry.eval = eval;
+}
+
+void EvalCache::clear() {
+	entries.clear();
+}
+
+static int elapsedMs(const SearchContext& context) {
+	auto now = std::chrono::steady_clock::now();
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - context.startTime).count());
+}
+
+static int msSinceLimitStart(const SearchContext& context) {
+	auto now = std::chrono::steady_clock::now();
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - context.limitStartTime).count());
+}
+
+static uint64_t nodesPerSecond(uint64_t nodes, int ms) {
+	return ms > 0 ? nodes * 1000 / ms : nodes * 1000;
+}
+
+static std::mutex uciOutputMutex;
+
+void uciWrite(const std::string& line) {
+	std::lock_guard<std::mutex> lock(uciOutputMutex);
+	std::cout << line << std::endl;
+}
+
+// "pv e2e4 e7e5"
+static std::string pvString(const std::vector<std::string>& pv) {
+	std::string text = "pv";
+	for (const std::string& move : pv) {
+		text += " " + move;
+	}
+	return text;
+}
+
+// "score cp 35" or "score mate 3" / "score mate -2"
+std::string uciScore(int score) {
+	if (score > MATE_SCORE - MAX_PLY) {
+		return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+	}
+	if (score < -MATE_SCORE + MAX_PLY) {
+		return "mate " + std::to_string(-(MATE_SCORE + score) / 2);
+	}
+	return "cp " + std::to_string(score);
+}
+
+// Prints an "info nodes ... nps ... time ..." line about once a second while searching.
+static void checkPeriodicInfo(SearchContext& context) {
+	if (!context.reportInfo || (context.stats.nodes & 1023) != 0) {
+		return;
+	}
+	auto now = std::chrono::steady_clock::now();
+	if (now - context.lastInfoTime < std::chrono::seconds(1)) {
+		return;
+	}
+	context.lastInfoTime = now;
+	int ms = elapsedMs(context);
+	uciWrite("info nodes " + std::to_string(context.stats.nodes)
+	         + " nps " + std::to_string(nodesPerSecond(context.stats.nodes, ms))
+	         + " time " + std::to_string(ms));
+}
+
+// Node limits are checked at every node, the clock and the GUI's "stop" only every 1024 nodes.
+// While pondering no limit applies, the clock starts running at the ponderhit.
+static bool checkLimits(SearchContext& context) {
+	if (context.stopped) {
+		return true;
+	}
+	if ((context.stats.nodes & 1023) == 0) {
+		if (context.stopRequested) {
+			context.stopped = true;
+			return true;
+		}
+		if (context.pondering) {
+			context.limitStartTime = std::chrono::steady_clock::now();
+			return false;
+		}
+	}
+	if (context.limits.nodes > 0 && context.stats.nodes >= context.limits.nodes && !context.pondering) {
+		context.stopped = true;
+	} else if (context.hardLimitMs > 0 && (context.stats.nodes & 1023) == 0) {
+		auto now = std::chrono::steady_clock::now();
+		if (now - context.limitStartTime >= std::chrono::milliseconds(context.hardLimitMs)) {
+			context.stopped = true;
+		}
+	}
+	return context.stopped;
+}
+
+int evaluateForSideToMove(Board& board) {
+	int eval = static_cast<int>(evaluatePosition(board));
+	return (board.getCurrentPlayer() == PieceColor::WHITE) ? eval : -eval;
+}
+
+// The key includes the side to move, so the side to move's eval can be cached as is.
+static int cachedEvaluate(Board& board, SearchContext& context) {
+	int eval;
+	context.stats.evalCacheProbes++;
+	if (context.evalCache.probe(board.getKey(), eval)) {
+		context.stats.evalCacheHits++;
+		return eval;
+	}
+	eval = evaluateForSideToMove(board);
+	context.evalCache.store(board.getKey(), eval);
+	return eval;
+}
+
+// Mate scores count plies from the root, the search cache counts them from the cached position.
+static int scoreToCache(int score, int ply) {
+	if (score > MATE_SCORE - MAX_PLY) return score + ply;
+	if (score < -MATE_SCORE + MAX_PLY) return score - ply;
+	return score;
+}
+
+static int scoreFromCache(int score, int ply) {
+	if (score > MATE_SCORE - MAX_PLY) return score - ply;
+	if (score < -MATE_SCORE + MAX_PLY) return score + ply;
+	return score;
+}
+
+// FNV-1a over every number the cached scores depend on.
+uint32_t searchCacheFingerprint(const SearchParams& params) {
+	uint32_t hash = 2166136261u;
+	auto mix = [&hash](int value) {
+		for (int i = 0; i < 4; i++) {
+			hash = (hash ^ static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i))) * 16777619u;
+		}
+	};
+	for (int type = 0; type < 6; type++) {
+		mix(PIECE_VALUES[type]);
+		for (int square = 0; square < 64; square++) {
+			mix(PIECE_SQUARE[type][square]);
+		}
+	}
+	mix(ENDGAME_VERSION);
+	mix(params.nullMove);
+	mix(params.nullMoveReduction);
+	mix(params.lmr);
+	mix(params.lmrMinDepth);
+	mix(params.lmrMinMoveIndex);
+	return hash;
+}
+
+// Follows the best moves of exact cache entries from this position, as far as they are legal.
+static std::vector<std::string> cachedPv(Board& board, const SearchCache& cache, int maxLength) {
+	std::vector<std::string> pv;
+	CacheEntry entry;
+	while (static_cast<int>(pv.size()) < maxLength && cache.probe(board.getKey(), entry) && entry.bound == CACHE_EXACT) {
+		std::string move = SearchCache::decodeMove(entry.move);
+		std::vector<std::string> legal = generateLegalMoves(board);
+		if (move.empty() || std::find(legal.begin(), legal.end(), move) == legal.end()) {
+			break;
+		}
+		board.pushMove(move);
+		pv.push_back(move);
+	}
+	for (size_t i = pv.size(); i > 0; i--) {
+		board.popMove(pv[i - 1]);
+	}
+	return pv;
+}
+
+static TraceRecord traceRecord(int ply, int depth, uint8_t flags, int alpha, int beta) {
+	TraceRecord record = {};
+	record.ply = static_cast<uint8_t>(ply);
+	record.depth = static_cast<uint8_t>(std::max(depth, 0));
+	record.flags = flags;
+	record.cutoff = TRACE_NO_CUTOFF;
+	record.alpha = alpha;
+	record.beta = beta;
+	return record;
+}
+
+// Writes the node's record if the search is traced, and passes its score on.
+static int traced(SearchContext& context, TraceRecord& record, int ply, int score) {
+	if (context.trace) {
+		record.move = context.trace->moveTo(ply);
+		record.score = score;
+		context.trace->add(record);
+	}
+	return score;
+}
+
+static void traceMove(SearchContext& context, int ply, const std::string& move) {
+	if (context.trace) {
+		context.trace->setMove(ply + 1, SearchCache::encodeMove(move));
+	}
+}
+
+// Captures include en passant: a pawn moving diagonally onto an empty square.
+bool isCapture(Board& board, const std::string& move) {
+	std::pair<int, int> from = board.convertUciToCoords(move.substr(0, 2));
+	std::pair<int, int> to = board.convertUciToCoords(move.substr(2, 2));
+	if (board.getPieceAt(to.first, to.second).getType() != PieceType::EMPTY) {
+		return true;
+	}
+	return board.getPieceAt(from.first, from.second).getType() == PieceType::PAWN && from.second != to.second;
+}
+
+static int pieceValue(PieceType type) {
+	switch (type) {
+		case PieceType::PAWN:   return 100;
+		case PieceType::KNIGHT: return 310;
+		case PieceType::BISHOP: return 320;
+		case PieceType::ROOK:   return 500;
+		case PieceType::QUEEN:  return 900;
+		case PieceType::KING:   return 2000;
+		default:                return 0;
+	}
+}
+
+// Sorts moves so that firstMove comes first, then captures by MVV-LVA, then promotions, then quiet moves.
+void orderMoves(Board& board, std::vector<std::string>& moves, const std::string& firstMove) {
+	std::vector<std::pair<int, std::string>> scored;
+	scored.reserve(moves.size());
+	for (const std::string& move : moves) {
+		int score = 0;
+		if (move == firstMove) {
+			score = 1000000;
+		} else {
+			std::pair<int, int> from = board.convertUciToCoords(move.substr(0, 2));
+			std::pair<int, int> to = board.convertUciToCoords(move.substr(2, 2));
+			Piece attacker = board.getPieceAt(from.first, from.second);
+			Piece victim = board.getPieceAt(to.first, to.second);
+			if (victim.getType() != PieceType::EMPTY) {
+				score = 10000 + 10 * pieceValue(victim.getType()) - pieceValue(attacker.getType()) / 10;
+			} else if (attacker.getType() == PieceType::PAWN && from.second != to.second) {
+				score = 10000 + 10 * pieceValue(PieceType::PAWN) - pieceValue(PieceType::PAWN) / 10;
+			}
+			if (move.length() == 5) {
+				score += (move[4] == 'q') ? 9000 : 0;
+			}
+		}
+		scored.push_back({score, move});
+	}
+	std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, std::string>& a, const std::pair<int, std::string>& b) {
+		return a.first > b.first;
+	});
+	for (size_t i = 0; i < moves.size(); i++) {
+		moves[i] = scored[i].second;
+	}
+}
+
+static bool hasNonPawnMaterial(Board& board, PieceColor color) {
+	for (int r = 2; r < BOARD_ROWS - 2; ++r) {
+		for (int c = 1; c < BOARD_COLS - 1; ++c) {
+			Piece piece = board.getPieceAt(r, c);
+			if (piece.getColor() == color && piece.getType() != PieceType::PAWN && piece.getType() != PieceType::KING) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+int quiescence(Board& board, SearchContext& context, int ply, int alpha, int beta) {
+	context.stats.nodes++;
+	context.stats.qnodes++;
+	context.stats.seldepth = std::max(context.stats.seldepth, ply);
+	checkPeriodicInfo(context);
+	if (checkLimits(context)) {
+		return 0;
+	}
+	TraceRecord record = traceRecord(ply, 0, TRACE_QUIESCENCE, alpha, beta);
+
+	int standPat = cachedEvaluate(board, context);
+	if (ply >= MAX_PLY - 1 || standPat >= beta) {
+		return traced(context, record, ply, standPat);
+	}
+	if (standPat > alpha) {
+		alpha = standPat;
+	}
+
+	std::vector<std::string> captures;
+	for (const std::string& move : generateLegalMoves(board)) {
+		if (isCapture(board, move)) {
+			captures.push_back(move);
+		}
+	}
+	orderMoves(board, captures, "");
+
+	for (size_t i = 0; i < captures.size(); i++) {
+		traceMove(context, ply, captures[i]);
+		board.pushMove(captures[i]);
+		int score = -quiescence(board, context, ply + 1, -beta, -alpha);
+		board.popMove(captures[i]);
+		if (context.stopped) {
+			return 0;
+		}
+		record.moves++;
+		if (score >= beta) {
+			context.stats.betaCutoffs++;
+			if (i == 0) {
+				context.stats.firstMoveCutoffs++;
+			}
+			record.cutoff = static_cast<uint8_t>(std::min<size_t>(i, TRACE_NO_CUTOFF - 1));
+			return traced(context, record, ply, score);
+		}
+		if (score > alpha) {
+			alpha = score;
+		}
+	}
+	return traced(context, record, ply, alpha);
+}
+
+int alphaBeta(Board& board, SearchContext& context, int depth, int ply, int alpha, int beta, bool allowNull, std::vector<std::string>& pv) {
+	pv.clear();
+	if (depth <= 0 || ply >= MAX_PLY - 1) {
+		return quiescence(board, context, ply, alpha, beta);
+	}
+	context.stats.nodes++;
+	context.stats.seldepth = std::max(context.stats.seldepth, ply);
+	checkPeriodicInfo(context);
+	if (checkLimits(context)) {
+		return 0;
+	}
+	TraceRecord record = traceRecord(ply, depth, 0, alpha, beta);
+
+	// Drawn lines: a repeated position, the fifty move rule, or a position where the
+	// side to move can repeat with a single move (so it never has to score below a draw).
+	if (ply > 0) {
+		if (board.isRepetition(ply) || board.getHalfmoveClock() >= 100) {
+			context.stats.drawCutoffs++;
+			context.drawScores++;
+			record.flags |= TRACE_DRAW;
+			return traced(context, record, ply, 0);
+		}
+		if (alpha < 0 && board.hasUpcomingRepetition(ply)) {
+			alpha = 0;
+			context.drawScores++;
+			if (alpha >= beta) {
+				context.stats.drawCutoffs++;
+				record.flags |= TRACE_DRAW;
+				return traced(context, record, ply, alpha);
+			}
+		}
+	}
+
+	// Results from earlier searches, possibly in earlier sessions. One at least as deep as
+	// this node needs settles it; otherwise its move is searched first.
+	int originalAlpha = alpha;
+	uint64_t drawScoresBefore = context.drawScores;
+	bool useSearchCache = context.searchCache && ply <= SEARCH_CACHE_MAX_PLY;
+	std::string cachedMove;
+	if (useSearchCache) {
+		CacheEntry cached;
+		context.stats.searchCacheProbes++;
+		if (context.searchCache->probe(board.getKey(), cached)) {
+			cachedMove = SearchCache::decodeMove(cached.move);
+			int score = scoreFromCache(cached.score, ply);
+			if (ply > 0 && cached.depth >= depth && (cached.bound == CACHE_EXACT
+			    || (cached.bound == CACHE_LOWER && score >= beta) || (cached.bound == CACHE_UPPER && score <= alpha))) {
+				context.stats.searchCacheCutoffs++;
+				if (cached.bound == CACHE_EXACT) {
+					pv = cachedPv(board, *context.searchCache, depth);
+				}
+				record.flags |= TRACE_CACHE_CUTOFF;
+				return traced(context, record, ply, score);
+			}
+		}
+	}
+
+	PieceColor us = board.getCurrentPlayer();
+	bool inCheck = board.isInCheck(us);
+	std::vector<std::string> childPv;
+	if (inCheck) {
+		record.flags |= TRACE_IN_CHECK;
+	}
+
+	// Null move pruning: if passing still fails high, a real move will too.
+	int reduction = context.params.nullMoveReduction;
+	if (context.params.nullMove && allowNull && ply > 0 && !inCheck && depth >= reduction + 1 && hasNonPawnMaterial(board, us)) {
+		context.stats.nullMoveTries++;
+		record.flags |= TRACE_NULL_TRIED;
+		if (context.trace) {
+			context.trace->setMove(ply + 1, 0);
+		}
+		board.pushNullMove();
+		int score = -alphaBeta(board, context, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false, childPv);
+		board.popNullMove();
+		if (score >= beta) {
+			context.stats.nullMoveCutoffs++;
+			record.flags |= TRACE_NULL_CUTOFF;
+			return traced(context, record, ply, beta);
+		}
+	}
+
+	std::vector<std::string> moves = generateLegalMoves(board);
+	if (moves.empty()) {
+		return traced(context, record, ply, inCheck ? -MATE_SCORE + ply : 0);
+	}
+	orderMoves(board, moves, (ply == 0 && !context.rootPvMove.empty()) ? context.rootPvMove : cachedMove);
+	if (ply == 0 && !context.excludedRootMoves.empty()) {
+		const std::vector<std::string>& excluded = context.excludedRootMoves;
+		moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const std::string& move) {
+			return std::find(excluded.begin(), excluded.end(), move) != excluded.end();
+		}), moves.end());
+	}
+
+	int bestScore = -INFINITE_SCORE;
+	std::string bestMove;
+	for (size_t i = 0; i < moves.size(); i++) {
+		const std::string& move = moves[i];
+		bool quiet = !isCapture(board, move) && move.length() == 4;
+		uint64_t nodesBefore = context.stats.nodes;
+		traceMove(context, ply, move);
+		board.pushMove(move);
+		bool givesCheck = board.isInCheck(board.getCurrentPlayer());
+
+		int score;
+		// Late move reductions: quiet moves late in the ordering get a shallower
+		// null-window search first, and are only searched fully if they beat alpha.
+		if (context.params.lmr && depth >= context.params.lmrMinDepth && static_cast<int>(i) >= context.params.lmrMinMoveIndex
+		    && quiet && !inCheck && !givesCheck) {
+			context.stats.lmrReductions++;
+			record.reductions++;
+			score = -alphaBeta(board, context, depth - 2, ply + 1, -alpha - 1, -alpha, true, childPv);
+			if (score > alpha) {
+				context.stats.lmrResearches++;
+				record.researches++;
+				score = -alphaBeta(board, context, depth - 1, ply + 1, -beta, -alpha, true, childPv);
+			}
+		} else {
+			score = -alphaBeta(board, context, depth - 1, ply + 1, -beta, -alpha, true, childPv);
+		}
+		board.popMove(move);
+		if (ply == 0) {
+			context.rootMoveNodes[move] += context.stats.nodes - nodesBefore;
+		}
+		if (context.stopped) {
+			return 0;
+		}
+		record.moves++;
+
+		if (score > bestScore) {
+			bestScore = score;
+			bestMove = move;
+		}
+		if (score > alpha) {
+			alpha = score;
+			pv.clear();
+			pv.push_back(move);
+			pv.insert(pv.end(), childPv.begin(), childPv.end());
+		}
+		if (alpha >= beta) {
+			context.stats.betaCutoffs++;
+			if (i == 0) {
+				context.stats.firstMoveCutoffs++;
+			}
+			record.cutoff = static_cast<uint8_t>(std::min<size_t>(i, TRACE_NO_CUTOFF - 1));
+			break;
+		}
+	}
+
+	// A root searched without some of its moves doesn't have the position's score, and
+	// neither does a node with a repetition or fifty move draw below it: reached by other
+	// moves, the same position may not be drawn there.
+	if (useSearchCache && depth >= SEARCH_CACHE_MIN_DEPTH && !bestMove.empty() && (ply > 0 || context.excludedRootMoves.empty())
+	    && context.drawScores == drawScoresBefore) {
+		CacheEntry entry;
+		entry.score = scoreToCache(bestScore, ply);
+		entry.move = SearchCache::encodeMove(bestMove);
+		entry.depth = static_cast<uint8_t>(depth);
+		entry.bound = bestScore >= beta ? CACHE_LOWER : bestScore <= originalAlpha ? CACHE_UPPER : CACHE_EXACT;
+		context.searchCache->store(board.getKey(), entry);
+	}
+	return traced(context, record, ply, bestScore);
+}
+
+// Iterative deepening up to context.limits.depth. Prints an info line per iteration.
+SearchResult search(Board& board, SearchContext& context) {
+	SearchResult result;
+	context.stats = SearchStats();
+	context.stopped = false;
+	context.rootPvMove.clear();
+	context.startTime = std::chrono::steady_clock::now();
+	context.lastInfoTime = context.startTime;
+	context.limitStartTime = context.startTime;
+	context.rootMoveNodes.clear();
+	// A cache written for other parameters holds scores this search wouldn't find.
+	if (context.searchCache && context.searchCache->getFingerprint() != searchCacheFingerprint(context.params)) {
+		context.searchCache = nullptr;
+	}
+	// movetime is a hard limit on its own, a clock gives soft and hard limits
+	context.hardLimitMs = context.limits.movetime;
+	if (context.limits.time.hardMs > 0 && (context.hardLimitMs == 0 || context.limits.time.hardMs < context.hardLimitMs)) {
+		context.hardLimitMs = context.limits.time.hardMs;
+	}
+
+	std::vector<std::string> rootMoves = generateLegalMoves(board);
+	if (rootMoves.empty()) {
+		return result;
+	}
+	result.bestMove = rootMoves[0];
+	context.timeManager.start(context.limits.time, static_cast<int>(rootMoves.size()));
+
+	// "go mate N" is answered by the proof-number search, alpha-beta only runs if it finds nothing.
+	// Answers that need no iterations still leave through the common end below.
+	bool answered = false;
+	if (context.limits.mate > 0) {
+		SearchResult mate;
+		bool stopped = false;
+		uint64_t maxNodes = context.limits.nodes > 0 ? context.limits.nodes : MATE_SEARCH_MAX_NODES;
+		bool found = findMate(board, context.limits.mate, maxNodes, context, mate, stopped);
+		context.stats.nodes += mate.nodes;
+		if (found) {
+			if (context.onIteration) {
+				context.onIteration(mate);
+			}
+			if (context.reportInfo) {
+				uciWrite("info depth " + std::to_string(mate.depth) + " score " + uciScore(mate.score)
+				         + " nodes " + std::to_string(mate.nodes) + " time " + std::to_string(mate.timeMs) + " " + pvString(mate.pv));
+			}
+			result.bestMove = mate.bestMove;
+			result.score = mate.score;
+			result.depth = mate.depth;
+			result.pv = mate.pv;
+			answered = true;
+		} else {
+			if (context.reportInfo) {
+				uciWrite("info string no mate in " + std::to_string(context.limits.mate) + " found ("
+				         + (stopped ? "stopped" : mate.nodes >= maxNodes ? "out of nodes" : "there is none") + ")");
+			}
+			answered = stopped;
+		}
+	}
+
+	// The search cache may already know this position at the depth asked for. Not after a
+	// reversible move, though: the cached line could repeat a position of this game.
+	if (!answered && context.searchCache && context.multiPV <= 1 && !context.limits.infinite && !context.pondering
+	    && board.getHalfmoveClock() == 0) {
+		CacheEntry cached;
+		context.stats.searchCacheProbes++;
+		if (context.searchCache->probe(board.getKey(), cached) && cached.bound == CACHE_EXACT && cached.depth >= context.limits.depth) {
+			std::vector<std::string> pv = cachedPv(board, *context.searchCache, cached.depth);
+			if (!pv.empty()) {
+				context.stats.searchCacheCutoffs++;
+				result.bestMove = pv[0];
+				result.score = cached.score;
+				result.depth = cached.depth;
+				result.pv = pv;
+				result.timeMs = elapsedMs(context);
+				if (context.onIteration) {
+					context.onIteration(result);
+				}
+				if (context.reportInfo) {
+					uciWrite("info depth " + std::to_string(result.depth) + " score " + uciScore(result.score)
+					         + " nodes 0 time " + std::to_string(result.timeMs) + " " + pvString(pv));
+					uciWrite("info string from the search cache");
+				}
+				answered = true;
+			}
+		}
+	}
+
+	// MultiPV: every iteration searches the root once per line, each time without the first
+	// moves of the lines before it. The lines share the eval and search caches.
+	int lineCount = std::max(1, std::min(context.multiPV, static_cast<int>(rootMoves.size())));
+	std::vector<std::string> previousLineMoves;
+	for (int depth = 1; !answered && depth <= context.limits.depth; depth++) {
+		std::vector<PvLine> lines;
+		for (int k = 0; k < lineCount; k++) {
+			if (k < static_cast<int>(previousLineMoves.size())) {
+				context.rootPvMove = previousLineMoves[k];
+			}
+			PvLine line;
+			line.score = alphaBeta(board, context, depth, 0, -INFINITE_SCORE, INFINITE_SCORE, false, line.pv);
+			if (context.stopped || line.pv.empty()) {
+				break;
+			}
+			context.excludedRootMoves.push_back(line.pv[0]);
+			lines.push_back(line);
+		}
+		context.excludedRootMoves.clear();
+		// An iteration cut short by a limit isn't trustworthy, keep the previous one.
+		if (context.stopped || static_cast<int>(lines.size()) < lineCount) {
+			break;
+		}
+		const std::vector<std::string>& pv = lines[0].pv;
+		int score = lines[0].score;
+		result.bestMove = pv[0];
+		result.score = score;
+		result.depth = depth;
+		result.pv = pv;
+		result.lines = lines;
+		context.rootPvMove = pv[0];
+		previousLineMoves.clear();
+		for (const PvLine& line : lines) {
+			previousLineMoves.push_back(line.pv[0]);
+		}
+		if (context.trace) {
+			TraceRecord iteration = traceRecord(0, depth, TRACE_ITERATION, -INFINITE_SCORE, INFINITE_SCORE);
+			iteration.move = SearchCache::encodeMove(pv[0]);
+			iteration.score = score;
+			context.trace->add(iteration);
+		}
+
+		if (context.onIteration) {
+			result.nodes = context.stats.nodes;
+			result.timeMs = elapsedMs(context);
+			for (int k = 0; k < lineCount; k++) {
+				SearchResult iteration = result;
+				iteration.multipv = k + 1;
+				iteration.bestMove = lines[k].pv[0];
+				iteration.score = lines[k].score;
+				iteration.pv = lines[k].pv;
+				context.onIteration(iteration);
+			}
+		}
+		if (context.reportInfo) {
+			int ms = elapsedMs(context);
+			for (int k = 0; k < lineCount; k++) {
+				std::ostringstream info;
+				info << "info depth " << depth
+				     << " seldepth " << context.stats.seldepth;
+				if (lineCount > 1) {
+					info << " multipv " << (k + 1);
+				}
+				info << " score " << uciScore(lines[k].score)
+				     << " nodes " << context.stats.nodes
+				     << " nps " << nodesPerSecond(context.stats.nodes, ms)
+				     << " time " << ms
+				     << " " << pvString(lines[k].pv);
+				uciWrite(info.str());
+			}
+		}
+
+		// No point searching deeper once a forced mate has been found.
+		if (!context.limits.infinite && (score > MATE_SCORE - MAX_PLY || score < -MATE_SCORE + MAX_PLY)) {
+			break;
+		}
+
+		double bestMoveNodeShare = context.stats.nodes > 0 ? static_cast<double>(context.rootMoveNodes[pv[0]]) / context.stats.nodes : 0.0;
+		context.timeManager.iterationDone(depth, pv[0], score, bestMoveNodeShare);
+		if (!context.pondering && context.timeManager.stopAfterIteration(msSinceLimitStart(context))) {
+			break;
+		}
+	}
+
+	if (context.searchCache) {
+		context.searchCache->flush();
+	}
+	if (context.trace) {
+		context.trace->flush();
+	}
+	result.nodes = context.stats.nodes;
+	result.timeMs = elapsedMs(context);
+	if (context.debug) {
+		printSearchStats(context.stats, result.timeMs / 1000.0);
+	}
+	return result;
+}
+
+void printSearchStats(const SearchStats& stats, double seconds) {
+	double firstMoveRate = stats.betaCutoffs > 0 ? 100.0 * stats.firstMoveCutoffs / stats.betaCutoffs : 0.0;
+	double qnodeRate = stats.nodes > 0 ? 100.0 * stats.qnodes / stats.nodes : 0.0;
+	double nullRate = stats.nullMoveTries > 0 ? 100.0 * stats.nullMoveCutoffs / stats.nullMoveTries : 0.0;
+	double lmrRate = stats.lmrReductions > 0 ? 100.0 * stats.lmrResearches / stats.lmrReductions : 0.0;
+	double evalHitRate = stats.evalCacheProbes > 0 ? 100.0 * stats.evalCacheHits / stats.evalCacheProbes : 0.0;
+	double searchCacheRate = stats.searchCacheProbes > 0 ? 100.0 * stats.searchCacheCutoffs / stats.searchCacheProbes : 0.0;
+	std::ostringstream out;
+	out << "info string nodes " << stats.nodes << " qnodes " << stats.qnodes << " (" << qnodeRate << "%)\n";
+	out << "info string time " << seconds << "s nps " << static_cast<uint64_t>(seconds > 0 ? stats.nodes / seconds : 0) << "\n";
+	out << "info string beta cutoffs " << stats.betaCutoffs << " first move " << stats.firstMoveCutoffs << " (" << firstMoveRate << "%)\n";
+	out << "info string null move tries " << stats.nullMoveTries << " cutoffs " << stats.nullMoveCutoffs << " (" << nullRate << "%)\n";
+	out << "info string lmr reductions " << stats.lmrReductions << " re-searches " << stats.lmrResearches << " (" << lmrRate << "%)\n";
+	out << "info string draw cutoffs " << stats.drawCutoffs << "\n";
+	out << "info string eval cache probes " << stats.evalCacheProbes << " hits " << stats.evalCacheHits << " (" << evalHitRate << "%)\n";
+	out << "info string search cache probes " << stats.searchCacheProbes << " cutoffs " << stats.searchCacheCutoffs << " (" << searchCacheRate << "%)\n";
+	out << "info string seldepth " << stats.seldepth;
+	uciWrite(out.str());
+}
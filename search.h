@@ -0,0 +1,147 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <map>
+#include <functional>
+#include <memory>
+#include "board.h"
+#include "timeman.h"
+#include "search_cache.h"
+#include "trace.h"
+
+const int MATE_SCORE = 100000;
+const int INFINITE_SCORE = 1000000;
+const int MAX_PLY = 128;
+const int DEFAULT_SEARCH_DEPTH = 5;
+
+const int NULL_MOVE_REDUCTION = 2;
+const int LMR_MIN_DEPTH = 3;
+const int LMR_MIN_MOVE_INDEX = 3;
+
+const int EVAL_CACHE_ENTRIES = 1 << 16; // per search thread, 16 bytes each
+
+// Counters kept by a single search thread. Each thread only ever writes its own copy,
+// the copies are added together when they are reported.
+struct SearchStats {
+	uint64_t nodes = 0;            // alphaBeta + quiescence nodes
+	uint64_t qnodes = 0;           // quiescence nodes only
+	uint64_t betaCutoffs = 0;
+	uint64_t firstMoveCutoffs = 0; // cutoffs produced by the first move searched
+	uint64_t nullMoveTries = 0;
+	uint64_t nullMoveCutoffs = 0;
+	uint64_t lmrReductions = 0;
+	uint64_t lmrResearches = 0;    // reduced searches that beat alpha and had to be searched again
+	uint64_t drawCutoffs = 0;      // nodes cut short by repetition or the fifty move rule
+	uint64_t evalCacheProbes = 0;
+	uint64_t evalCacheHits = 0;
+	uint64_t searchCacheProbes = 0;
+	uint64_t searchCacheCutoffs = 0; // subtrees (or whole searches) answered by the search cache
+	int seldepth = 0;
+
+	void add(const SearchStats& other);
+};
+
+// Tunable search parameters, so two differently configured engines can play each other (see match.h).
+struct SearchParams {
+	bool nullMove = true;
+	int nullMoveReduction = NULL_MOVE_REDUCTION;
+	bool lmr = true;
+	int lmrMinDepth = LMR_MIN_DEPTH;
+	int lmrMinMoveIndex = LMR_MIN_MOVE_INDEX;
+
+	// "name=value" with name one of nullmove, nmr, lmr, lmrdepth, lmrmoves. False if unknown.
+	bool set(const std::string& name, int value);
+};
+
+// Small lossy cache of static evaluations keyed by the Zobrist key, so transpositions,
+// re-searches and quiescence don't evaluate the same position over and over. A new entry
+// always replaces the old one in its slot. Memory is only allocated on the first store.
+class EvalCache {
+public:
+	bool probe(uint64_t key, int& eval) const;
+	void store(uint64_t key, int eval);
+	void clear();
+
+private:
+	struct Entry {
+		uint64_t key = 0;
+		int eval = 0;
+	};
+	std::vector<Entry> entries;
+};
+
+struct SearchLimits {
+	int depth = DEFAULT_SEARCH_DEPTH;
+	uint64_t nodes = 0; // 0 = no node limit
+	int movetime = 0;   // milliseconds, 0 = no time limit
+	TimeBudget time;    // from the clock ("go wtime ..."), see timeman.h. 0 = none
+	bool infinite = false; // "go infinite": search until "stop"
+	int mate = 0;       // "go mate N": look for a mate in N moves first (see mate.h)
+};
+
+struct PvLine {
+	int score = 0;
+	std::vector<std::string> pv;
+};
+
+struct SearchResult {
+	std::string bestMove;
+	int score = 0;
+	int depth = 0;
+	std::vector<std::string> pv;
+	uint64_t nodes = 0;
+	int timeMs = 0;
+	int multipv = 1;           // in onIteration: which MultiPV line this is, 1 = the best
+	std::vector<PvLine> lines; // MultiPV: all lines of the last full iteration, best first
+};
+
+// Per-thread search state. One of these is only ever used by one thread at a time,
+// except for stopRequested and pondering, which the UCI thread sets while it searches.
+struct SearchContext {
+	SearchLimits limits;
+	SearchParams params;
+	SearchStats stats;
+	bool debug = false;      // "debug on": print a detailed stats dump after the search
+	bool reportInfo = true;  // print UCI info lines while searching
+	std::function<void(const SearchResult&)> onIteration; // called after every finished iteration, if set
+	bool stopped = false;    // set when a limit runs out, the search unwinds and keeps the last full iteration
+	std::atomic<bool> stopRequested{false}; // "stop" from the GUI
+	std::atomic<bool> pondering{false};     // "go ponder": no time limit until "ponderhit" clears this
+	int multiPV = 1;         // lines searched at the root per iteration ("MultiPV" option)
+	std::string rootPvMove;  // best move of the previous iteration, searched first
+	std::vector<std::string> excludedRootMoves; // MultiPV: root moves taken by the lines already searched
+	std::map<std::string, uint64_t> rootMoveNodes; // nodes spent below each root move, for the time manager
+	TimeManager timeManager;
+	EvalCache evalCache;     // evals don't depend on the search, so this can be kept from one search to the next
+	SearchCache* searchCache = nullptr; // optional results on disk, may be shared by many threads (see search_cache.h);
+	                                    // search() drops it if its fingerprint isn't the one of these params
+	uint64_t drawScores = 0; // repetition and fifty move scores so far, they depend on the moves before the position
+	std::unique_ptr<TraceWriter> trace;  // set to record every node (see trace.h)
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point limitStartTime; // time limits count from here, the end of pondering
+	int hardLimitMs = 0;     // the smaller of movetime and the clock's hard limit, 0 = none
+	std::chrono::steady_clock::time_point lastInfoTime;
+};
+
+// Writes one line of engine output to stdout. The search thread and the UCI thread both
+// talk to the GUI, so every line is built first and written whole under one lock.
+void uciWrite(const std::string& line);
+std::string uciScore(int score);
+// Hash of the evaluation parameters, the endgame rules and params, for the search cache header.
+uint32_t searchCacheFingerprint(const SearchParams& params);
+int evaluateForSideToMove(Board& board);
+bool isCapture(Board& board, const std::string& move);
+void orderMoves(Board& board, std::vector<std::string>& moves, const std::string& firstMove);
+
+int quiescence(Board& board, SearchContext& context, int ply, int alpha, int beta);
+int alphaBeta(Board& board, SearchContext& context, int depth, int ply, int alpha, int beta, bool allowNull, std::vector<std::string>& pv);
+SearchResult search(Board& board, SearchContext& context);
+
+void printSearchStats(const SearchStats& stats, double seconds);
+
+#endif
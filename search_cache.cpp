@@ -0,0 +1,382 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "search_cache.h"
+
+static const char CACHE_MAGIC[4] = {'B', 'B', 'S', 'C'};
+static const uint32_t CACHE_VERSION = 2;
+static const size_t CACHE_HEADER_BYTES = 16;
+static const size_t CACHE_RECORD_BYTES = 24;
+static const size_t CACHE_FLUSH_RECORDS = 256;
+
+static void putLe(unsigned char* out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		out[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+}
+
+static uint64_t getLe(const unsigned char* in, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= static_cast<uint64_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+// FNV-1a. Never 0 for the all-zero record a file extended by a crash may end in.
+static uint32_t recordChecksum(const unsigned char* record) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < CACHE_RECORD_BYTES - 4; i++) {
+		hash = (hash ^ record[i]) * 16777619u;
+	}
+	return hash | 1;
+}
+
+static void encodeRecord(unsigned char* out, uint64_t key, const CacheEntry& entry) {
+	putLe(out, key, 8);
+	putLe(out + 8, static_cast<uint32_t>(entry.score), 4);
+	putLe(out + 12, entry.move, 2);
+	out[14] = entry.depth;
+	out[15] = entry.bound;
+	putLe(out + 16, 0, 4);
+	putLe(out + 20, recordChecksum(out), 4);
+}
+
+static bool decodeRecord(const unsigned char* in, uint64_t& key, CacheEntry& entry) {
+	if (getLe(in + 20, 4) != recordChecksum(in) || in[15] > CACHE_UPPER) {
+		return false;
+	}
+	key = getLe(in, 8);
+	entry.score = static_cast<int32_t>(static_cast<uint32_t>(getLe(in + 8, 4)));
+	entry.move = static_cast<uint16_t>(getLe(in + 12, 2));
+	entry.depth = in[14];
+	entry.bound = in[15];
+	return true;
+}
+
+uint16_t SearchCache::encodeMove(const std::string& move) {
+	if (move.length() < 4) {
+		return 0;
+	}
+	int from = (move[1] - '1') * 8 + (move[0] - 'a');
+	int to = (move[3] - '1') * 8 + (move[2] - 'a');
+	if (from < 0 || from >= 64 || to < 0 || to >= 64) {
+		return 0;
+	}
+	int promotion = 0;
+	if (move.length() == 5) {
+		size_t index = std::string("nbrq").find(move[4]);
+		promotion = (index == std::string::npos) ? 0 : static_cast<int>(index) + 1;
+	}
+	return static_cast<uint16_t>(from | (to << 6) | (promotion << 12));
+}
+
+std::string SearchCache::decodeMove(uint16_t move) {
+	int from = move & 63;
+	int to = (move >> 6) & 63;
+	int promotion = (move >> 12) & 7;
+	if (from == to) {
+		return "";
+	}
+	std::string text;
+	text += static_cast<char>('a' + from % 8);
+	text += static_cast<char>('1' + from / 8);
+	text += static_cast<char>('a' + to % 8);
+	text += static_cast<char>('1' + to / 8);
+	if (promotion >= 1 && promotion <= 4) {
+		text += "nbrq"[promotion - 1];
+	}
+	return text;
+}
+
+SearchCache::~SearchCache() {
+	close();
+}
+
+bool SearchCache::probe(uint64_t key, CacheEntry& entry) const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	auto found = entries.find(key);
+	if (found == entries.end()) {
+		return false;
+	}
+	entry = found->second;
+	return true;
+}
+
+void SearchCache::store(uint64_t key, const CacheEntry& entry) {
+	if (readOnly) {
+		return;
+	}
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (fd < 0) {
+		return;
+	}
+	auto found = entries.find(key);
+	if (found != entries.end()) {
+		const CacheEntry& old = found->second;
+		if (old.depth > entry.depth) {
+			return;
+		}
+		if (old.depth == entry.depth && old.score == entry.score && old.move == entry.move && old.bound == entry.bound) {
+			return; // nothing new to write
+		}
+	}
+	entries[key] = entry;
+	pending.push_back({key, entry});
+	if (pending.size() >= CACHE_FLUSH_RECORDS) {
+		flushLocked();
+	}
+}
+
+void SearchCache::flush() {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	flushLocked();
+}
+
+size_t SearchCache::size() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return entries.size();
+}
+
+std::string SearchCache::describe() const {
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	uint64_t bytes = CACHE_HEADER_BYTES + (fileRecords + pending.size()) * CACHE_RECORD_BYTES;
+	return path + ": " + std::to_string(entries.size()) + " positions, " + std::to_string(bytes / 1024) + " KB"
+	       + (readOnly ? ", read-only (another process has it open)" : "");
+}
+
+#ifdef _WIN32
+
+bool SearchCache::open(const std::string& path, int, uint32_t, std::string& error) {
+	error = "the search cache needs a POSIX system, " + path + " not opened";
+	return false;
+}
+
+void SearchCache::close() {
+}
+
+bool SearchCache::load(std::string&) { return false; }
+bool SearchCache::compact() { return false; }
+bool SearchCache::writeRecords(int, const std::vector<std::pair<uint64_t, CacheEntry>>&) { return false; }
+void SearchCache::flushLocked() { pending.clear(); }
+
+#else
+
+static bool writeAll(int file, const unsigned char* data, size_t size) {
+	while (size > 0) {
+		ssize_t written = ::write(file, data, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+bool SearchCache::open(const std::string& path, int maxMB, uint32_t fingerprint, std::string& error) {
+	close();
+	this->path = path;
+	this->fingerprint = fingerprint;
+	maxRecords = std::max<uint64_t>(1024, static_cast<uint64_t>(std::max(1, maxMB)) * 1024 * 1024 / CACHE_RECORD_BYTES);
+
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	readOnly = false;
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+		// Someone else writes to it: use what's there, add nothing.
+		::close(fd);
+		fd = ::open(path.c_str(), O_RDONLY);
+		readOnly = true;
+	}
+	if (fd < 0) {
+		error = "can't open " + path + ": " + std::strerror(errno);
+		return false;
+	}
+	if (!load(error)) {
+		::close(fd);
+		fd = -1;
+		return false;
+	}
+	// Mostly replaced records: start with a clean file.
+	if (!readOnly && fileRecords > 2 * entries.size() + CACHE_FLUSH_RECORDS) {
+		compact();
+	}
+	return true;
+}
+
+// Replays the records of the file into the index and drops a torn tail.
+bool SearchCache::load(std::string& error) {
+	entries.clear();
+	pending.clear();
+	fileRecords = 0;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		error = "can't stat " + path;
+		return false;
+	}
+	size_t size = static_cast<size_t>(info.st_size);
+	if (size < CACHE_HEADER_BYTES) {
+		if (readOnly) {
+			return true; // the writer hasn't written its header yet
+		}
+		unsigned char header[CACHE_HEADER_BYTES] = {};
+		std::memcpy(header, CACHE_MAGIC, 4);
+		putLe(header + 4, CACHE_VERSION, 4);
+		putLe(header + 8, CACHE_RECORD_BYTES, 4);
+		putLe(header + 12, fingerprint, 4);
+		if (ftruncate(fd, 0) != 0 || lseek(fd, 0, SEEK_SET) != 0 || !writeAll(fd, header, sizeof(header))) {
+			error = "can't write " + path;
+			return false;
+		}
+		return true;
+	}
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED) {
+		error = "can't map " + path;
+		return false;
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	const unsigned char* data = static_cast<const unsigned char*>(mapped);
+	if (std::memcmp(data, CACHE_MAGIC, 4) != 0 || getLe(data + 4, 4) != CACHE_VERSION || getLe(data + 8, 4) != CACHE_RECORD_BYTES) {
+		munmap(mapped, size);
+		error = path + " is not a BearBot search cache (or one of another version)";
+		return false;
+	}
+	if (getLe(data + 12, 4) != fingerprint) {
+		munmap(mapped, size);
+		error = path + " was written with other evaluation or search parameters";
+		return false;
+	}
+
+	size_t offset = CACHE_HEADER_BYTES;
+	while (offset + CACHE_RECORD_BYTES <= size) {
+		uint64_t key;
+		CacheEntry entry;
+		if (!decodeRecord(data + offset, key, entry)) {
+			break;
+		}
+		auto found = entries.find(key);
+		if (found == entries.end() || found->second.depth <= entry.depth) {
+			entries[key] = entry;
+		}
+		fileRecords++;
+		offset += CACHE_RECORD_BYTES;
+	}
+	munmap(mapped, size);
+
+	if (!readOnly) {
+		if (offset < size && ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+			error = "can't truncate the damaged end of " + path;
+			return false;
+		}
+		lseek(fd, static_cast<off_t>(offset), SEEK_SET);
+	}
+	return true;
+}
+
+void SearchCache::close() {
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (fd < 0) {
+		return;
+	}
+	flushLocked();
+	if (!readOnly) {
+		fsync(fd);
+	}
+	::close(fd); // drops the lock too
+	fd = -1;
+	entries.clear();
+	pending.clear();
+	fileRecords = 0;
+}
+
+void SearchCache::flushLocked() {
+	if (pending.empty() || fd < 0 || readOnly) {
+		pending.clear();
+		return;
+	}
+	if (fileRecords + pending.size() > maxRecords) {
+		pending.clear();
+		compact(); // writes every live entry, the pending ones included
+		return;
+	}
+	if (writeRecords(fd, pending)) {
+		fileRecords += pending.size();
+	}
+	pending.clear();
+}
+
+bool SearchCache::writeRecords(int file, const std::vector<std::pair<uint64_t, CacheEntry>>& records) {
+	std::vector<unsigned char> buffer(records.size() * CACHE_RECORD_BYTES);
+	for (size_t i = 0; i < records.size(); i++) {
+		encodeRecord(&buffer[i * CACHE_RECORD_BYTES], records[i].first, records[i].second);
+	}
+	return writeAll(file, buffer.data(), buffer.size());
+}
+
+// Writes the live entries to path.tmp and renames it over the file. Keeps the deepest
+// three quarters of maxRecords if there are more, so compactions don't follow each other.
+bool SearchCache::compact() {
+	std::vector<std::pair<uint64_t, CacheEntry>> live(entries.begin(), entries.end());
+	size_t keep = static_cast<size_t>(maxRecords * 3 / 4);
+	if (live.size() > keep) {
+		std::nth_element(live.begin(), live.begin() + keep, live.end(),
+		                 [](const std::pair<uint64_t, CacheEntry>& a, const std::pair<uint64_t, CacheEntry>& b) {
+			return a.second.depth > b.second.depth;
+		});
+		live.resize(keep);
+		entries = std::unordered_map<uint64_t, CacheEntry>(live.begin(), live.end());
+	}
+
+	std::string tmpPath = path + ".tmp";
+	int tmp = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (tmp < 0) {
+		return false;
+	}
+	// Lock the new file before it takes the name, so no other process gets it unlocked.
+	flock(tmp, LOCK_EX | LOCK_NB);
+	unsigned char header[CACHE_HEADER_BYTES] = {};
+	std::memcpy(header, CACHE_MAGIC, 4);
+	putLe(header + 4, CACHE_VERSION, 4);
+	putLe(header + 8, CACHE_RECORD_BYTES, 4);
+	putLe(header + 12, fingerprint, 4);
+	if (!writeAll(tmp, header, sizeof(header)) || !writeRecords(tmp, live) || fsync(tmp) != 0
+	    || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		::close(tmp);
+		unlink(tmpPath.c_str());
+		// The old file is untouched: keep appending to it.
+		return false;
+	}
+	::close(fd);
+	fd = tmp;
+	fileRecords = live.size();
+
+	// Make the rename itself survive a crash.
+	size_t slash = path.find_last_of('/');
+	std::string directory = (slash == std::string::npos) ? "." : path.substr(0, slash + (slash == 0 ? 1 : 0));
+	int dir = ::open(directory.c_str(), O_RDONLY);
+	if (dir >= 0) {
+		fsync(dir);
+		::close(dir);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef SEARCH_CACHE_H_
+#define SEARCH_CACHE_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Deep search results kept on disk from one session to the next, so positions that get
+// analyzed over and over (the opening, popular lines) are answered from the file instead
+// of being searched again. Optional: only searches given a cache use it (see SearchContext).
+//
+// The search probes it at the root and the first few plies, and stores what it finds there
+// when the remaining depth is large enough to be worth keeping. A result at least as deep
+// as the search asks for ends the search at the root, and cuts off a subtree further down.
+//
+// File layout, little endian: a 16 byte header ("BBSC", version, record size, fingerprint),
+// then 24 byte records appended one after the other:
+//   0  uint64 key     Zobrist key of the position (side to move included)
+//   8  int32  score   from the side to move's point of view, mates counted from this position
+//   12 uint16 move    from square | to square << 6 | promotion << 12 (a1 = 0, promotion 1 n .. 4 q)
+//   14 uint8  depth
+//   15 uint8  bound   CACHE_EXACT, CACHE_LOWER or CACHE_UPPER
+//   16 uint32 0
+//   20 uint32 checksum of bytes 0-19
+// A later record for the same key replaces an earlier one. Opening the file (memory-mapped)
+// replays the records and cuts off anything after the last one with a good checksum, which
+// is all a crash can leave behind. Compaction writes only the live entries to a new file and
+// renames it over the old one, so at any moment one of the two is complete. The process that
+// opens the file first locks it; others open it read-only and never write.
+//
+// The fingerprint (searchCacheFingerprint in search.h) hashes everything the scores depend
+// on: the evaluation parameters, the endgame rules and the search parameters. A file written
+// with other ones is refused like a file of another version. Scores that depend on the moves
+// before the position (repetitions, the fifty move rule) are never stored.
+enum CacheBound : uint8_t {
+	CACHE_EXACT = 0,
+	CACHE_LOWER = 1, // the score is at least this (the search failed high)
+	CACHE_UPPER = 2  // the score is at most this (the search failed low)
+};
+
+const int SEARCH_CACHE_MAX_PLY = 3;     // probed and stored at plies 0 .. 3
+const int SEARCH_CACHE_MIN_DEPTH = 5;   // below ply 0, only results this deep are stored
+const int SEARCH_CACHE_DEFAULT_MB = 64;
+
+struct CacheEntry {
+	int score = 0;
+	uint16_t move = 0;
+	uint8_t depth = 0;
+	uint8_t bound = CACHE_EXACT;
+};
+
+class SearchCache {
+public:
+	SearchCache() = default;
+	~SearchCache();
+	SearchCache(const SearchCache&) = delete;
+	SearchCache& operator=(const SearchCache&) = delete;
+
+	// Opens (or creates) the cache file. maxMB limits the file: once the records pass it,
+	// the cache is compacted, dropping the shallowest entries if it's still too big.
+	// False with error set if the file can't be used or was written with another fingerprint.
+	bool open(const std::string& path, int maxMB, uint32_t fingerprint, std::string& error);
+	void close(); // writes what's still buffered
+	bool isOpen() const { return fd >= 0; }
+	bool isReadOnly() const { return readOnly; }
+	uint32_t getFingerprint() const { return fingerprint; }
+
+	bool probe(uint64_t key, CacheEntry& entry) const;
+	// Replaces the entry for key unless the one there is deeper. Appends are buffered;
+	// they reach the file on flush(), every 256 records, or on close().
+	void store(uint64_t key, const CacheEntry& entry);
+	void flush();
+
+	size_t size() const;
+	std::string describe() const; // "path: N positions, M KB, read-only"
+
+	static uint16_t encodeMove(const std::string& move);
+	static std::string decodeMove(uint16_t move); // "" for 0
+
+private:
+	bool load(std::string& error);
+	bool compact();
+	bool writeRecords(int file, const std::vector<std::pair<uint64_t, CacheEntry>>& records);
+	void flushLocked();
+
+	std::string path;
+	bool readOnly = false;
+	uint32_t fingerprint = 0;
+	uint64_t maxRecords = 0;
+
+	mutable std::shared_mutex mutex; // guards everything below
+	int fd = -1;               // compaction swaps in the new file
+	uint64_t fileRecords = 0;  // records in the file, including replaced ones
+	std::unordered_map<uint64_t, CacheEntry> entries;
+	std::vector<std::pair<uint64_t, CacheEntry>> pending; // stored but not written yet
+};
+
+#endif
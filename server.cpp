@@ -0,0 +1,276 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "server.h"
+#include "uci.h"
+#include "numa.h"
+#include "engine.h"
+
+Server::Server(int workerCount, const SearchLimits& budget, Output output) : defaultBudget(budget), output(output) {
+	for (int i = 0; i < std::max(1, workerCount); i++) {
+		workers.emplace_back(&Server::workerLoop, this, i);
+	}
+}
+
+Server::~Server() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+		for (auto& entry : sessions) {
+			if (entry.second->context) {
+				entry.second->context->stopRequested = true;
+			}
+		}
+		for (auto& session : queue) {
+			session->state = SearchState::IDLE;
+			session->context.reset();
+		}
+		queue.clear();
+	}
+	workAvailable.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void Server::send(const std::string& id, const std::string& reply) {
+	std::lock_guard<std::mutex> lock(outputMutex);
+	output(id + " " + reply);
+}
+
+bool Server::handleLine(const std::string& line) {
+	std::vector<std::string> segments = parseCommand(line);
+	if (segments.empty()) {
+		return true;
+	}
+	if (segments[0] == "quit") {
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if (segments[0] == "stats") {
+		send("server", "sessions " + std::to_string(sessions.size()) + " queued " + std::to_string(queue.size())
+		     + " running " + std::to_string(running) + " searches " + std::to_string(searchesDone));
+		return true;
+	}
+
+	const std::string& id = segments[0];
+	if (segments.size() < 2) {
+		send(id, "error missing command");
+		return true;
+	}
+	std::vector<std::string> command(segments.begin() + 1, segments.end());
+	auto found = sessions.find(id);
+	if (command[0] == "open") {
+		if (found != sessions.end()) {
+			send(id, "error session exists");
+			return true;
+		}
+		std::shared_ptr<Session> session = std::make_shared<Session>();
+		session->id = id;
+		session->budget = defaultBudget;
+		sessions[id] = session;
+		send(id, "ok");
+		return true;
+	}
+	if (found == sessions.end()) {
+		send(id, "error unknown session");
+		return true;
+	}
+	std::shared_ptr<Session> session = found->second;
+
+	if (command[0] == "position") {
+		stopSearch(session, lock);
+		std::string base;
+		std::vector<std::string> moves;
+		if (!parsePositionCommand(command, base, moves) || !applyPosition(session->board, session->position, base, moves)) {
+			send(id, "info string invalid position");
+		}
+	} else if (command[0] == "ucinewgame") {
+		stopSearch(session, lock);
+		session->board.initializeBoard();
+		session->position = PositionState();
+	} else if (command[0] == "go") {
+		stopSearch(session, lock);
+		startSearch(session, command);
+	} else if (command[0] == "stop") {
+		stopSearch(session, lock);
+	} else if (command[0] == "budget") {
+		for (size_t i = 1; i + 1 < command.size(); i += 2) {
+			if (command[i] == "nodes") session->budget.nodes = std::strtoull(command[i + 1].c_str(), nullptr, 10);
+			else if (command[i] == "movetime") session->budget.movetime = std::atoi(command[i + 1].c_str());
+		}
+		// A session may only tighten the server's budget
+		if (defaultBudget.nodes > 0 && (session->budget.nodes == 0 || session->budget.nodes > defaultBudget.nodes)) {
+			session->budget.nodes = defaultBudget.nodes;
+		}
+		if (defaultBudget.movetime > 0 && (session->budget.movetime <= 0 || session->budget.movetime > defaultBudget.movetime)) {
+			session->budget.movetime = defaultBudget.movetime;
+		}
+		send(id, "budget nodes " + std::to_string(session->budget.nodes) + " movetime " + std::to_string(session->budget.movetime));
+	} else if (command[0] == "isready") {
+		send(id, "readyok");
+	} else if (command[0] == "close") {
+		stopSearch(session, lock);
+		sessions.erase(id);
+		send(id, "closed");
+	} else {
+		send(id, "error unknown command " + command[0]);
+	}
+	return true;
+}
+
+void Server::startSearch(const std::shared_ptr<Session>& session, const std::vector<std::string>& commandSegments) {
+	bool ponder;
+	SearchLimits limits = parseGoLimits(commandSegments, session->board.getCurrentPlayer(), ponder);
+	// The budget caps whatever the client asked for. Nothing here waits for a "stop",
+	// a worker is never held by an idle search.
+	if (session->budget.nodes > 0 && (limits.nodes == 0 || limits.nodes > session->budget.nodes)) {
+		limits.nodes = session->budget.nodes;
+	}
+	if (session->budget.movetime > 0 && (limits.movetime == 0 || limits.movetime > session->budget.movetime)) {
+		limits.movetime = session->budget.movetime;
+	}
+	limits.infinite = false;
+
+	session->context.reset(new SearchContext());
+	session->context->limits = limits;
+	session->context->reportInfo = false;
+	session->context->searchCache = searchCache;
+	std::string id = session->id;
+	session->context->onIteration = [this, id](const SearchResult& iteration) {
+		std::string info = "info depth " + std::to_string(iteration.depth) + " score " + uciScore(iteration.score)
+		                 + " nodes " + std::to_string(iteration.nodes) + " time " + std::to_string(iteration.timeMs) + " pv";
+		for (const std::string& move : iteration.pv) {
+			info += " " + move;
+		}
+		send(id, info);
+	};
+	session->state = SearchState::QUEUED;
+	queue.push_back(session);
+	workAvailable.notify_one();
+}
+
+void Server::stopSearch(const std::shared_ptr<Session>& session, std::unique_lock<std::mutex>& lock) {
+	if (session->state == SearchState::QUEUED) {
+		// Never started: answer right away with any legal move. No search runs on this
+		// thread, it would hold up every other session's input until it noticed the stop.
+		queue.erase(std::find(queue.begin(), queue.end(), session));
+		std::vector<std::string> moves = generateLegalMoves(session->board);
+		send(session->id, "bestmove " + (moves.empty() ? std::string("0000") : moves[0]));
+		session->state = SearchState::IDLE;
+		session->context.reset();
+		searchesDone++;
+		searchDone.notify_all();
+	} else if (session->state == SearchState::RUNNING) {
+		session->context->stopRequested = true;
+		searchDone.wait(lock, [&]() { return session->state == SearchState::IDLE; });
+	}
+}
+
+// Runs the search without the lock held, sends its bestmove and frees the search state.
+// The eval cache belongs to the thread that runs the search and is lent to the context.
+void Server::finishSearch(const std::shared_ptr<Session>& session, SearchContext& context, EvalCache& evalCache) {
+	std::swap(context.evalCache, evalCache);
+	SearchResult result = search(session->board, context);
+	std::swap(context.evalCache, evalCache);
+	std::string reply = "bestmove " + (result.bestMove.empty() ? std::string("0000") : result.bestMove);
+	if (result.pv.size() > 1) {
+		reply += " ponder " + result.pv[1];
+	}
+	send(session->id, reply);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	session->state = SearchState::IDLE;
+	session->context.reset();
+	running--;
+	searchesDone++;
+	searchDone.notify_all();
+}
+
+void Server::workerLoop(int workerIndex) {
+	pinWorkerThread(workerIndex);
+	EvalCache evalCache;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		workAvailable.wait(lock, [&]() { return shuttingDown || !queue.empty(); });
+		if (shuttingDown) {
+			return;
+		}
+		std::shared_ptr<Session> session = queue.front();
+		queue.pop_front();
+		session->state = SearchState::RUNNING;
+		running++;
+		SearchContext* context = session->context.get();
+		lock.unlock();
+		finishSearch(session, *context, evalCache);
+		lock.lock();
+	}
+}
+
+void Server::waitIdle() {
+	std::unique_lock<std::mutex> lock(mutex);
+	searchDone.wait(lock, [&]() { return queue.empty() && running == 0; });
+}
+
+void Server::setSearchCache(SearchCache* cache) {
+	searchCache = cache;
+}
+
+size_t Server::sessionCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return sessions.size();
+}
+
+int runServer(const std::vector<std::string>& args) {
+	int workerCount = 0;
+	std::string cachePath;
+	int cacheMB = SEARCH_CACHE_DEFAULT_MB;
+	SearchLimits budget;
+	budget.nodes = 5000000;
+	for (size_t i = 0; i < args.size(); i++) {
+		bool hasValue = i + 1 < args.size();
+		if (args[i] == "--workers" && hasValue) workerCount = std::atoi(args[++i].c_str());
+		else if (args[i] == "--max-nodes" && hasValue) budget.nodes = std::strtoull(args[++i].c_str(), nullptr, 10);
+		else if (args[i] == "--max-movetime" && hasValue) budget.movetime = std::atoi(args[++i].c_str());
+		else if (args[i] == "--cache" && hasValue) cachePath = args[++i];
+		else if (args[i] == "--cache-mb" && hasValue) cacheMB = std::atoi(args[++i].c_str());
+		else {
+			std::cerr << "Unknown server option: " << args[i] << std::endl;
+			return 1;
+		}
+	}
+	if (workerCount < 1) {
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	SearchCache cache;
+	if (!cachePath.empty()) {
+		std::string error;
+		if (!cache.open(cachePath, cacheMB, searchCacheFingerprint(SearchParams()), error)) {
+			std::cerr << error << std::endl;
+			return 1;
+		}
+		std::cerr << "Search cache " << cache.describe() << std::endl;
+	}
+
+	Server server(workerCount, budget, [](const std::string& line) {
+		std::cout << line << std::endl;
+	});
+	if (cache.isOpen()) {
+		server.setSearchCache(&cache);
+	}
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		if (!server.handleLine(line)) {
+			return 0;
+		}
+	}
+	// End of input: let the searches that were asked for finish.
+	server.waitIdle();
+	return 0;
+}
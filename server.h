@@ -0,0 +1,97 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "board.h"
+#include "search.h"
+#include "engine_api.h"
+
+// Many engine sessions in one process: "bearbot server [options]"
+//
+//   --workers N         searches run at once, shared by all sessions (default: all cores)
+//   --max-nodes N       node budget of a single search (default 5000000, 0 = none)
+//   --max-movetime MS   time budget of a single search (default 0 = none)
+//   --cache FILE        search cache shared by all sessions and kept across runs (see search_cache.h)
+//   --cache-mb N        size limit of the cache file (default 64)
+//
+// Every input line is "<session> <command>", every output line "<session> <reply>", so
+// any number of clients can be multiplexed over one stdin/stdout pair. Commands:
+//
+//   <id> open                          create a session (its own board and position)
+//   <id> position startpos moves ...   as in UCI
+//   <id> go [wtime ... | nodes N | movetime MS | depth N | infinite]
+//                                      queue a search, answered with info lines and "<id> bestmove ..."
+//   <id> stop                          end the session's search (queued or running)
+//   <id> budget [nodes N] [movetime MS] lower the session's per-search budget
+//   <id> isready                       "<id> readyok"
+//   <id> close                         stop and forget the session
+//   stats                              "server sessions .. queued .. running .. searches .."
+//   quit
+//
+// An idle session is just a board. Search state is only allocated while a search is
+// queued or running. Searches wait in one FIFO queue and each session can have only one
+// search in it, so sessions take turns. The budget caps every search, also "go infinite"
+// and "go ponder" (which searches normally here), so no session can hold a worker forever.
+class Server {
+public:
+	using Output = std::function<void(const std::string& line)>;
+
+	Server(int workerCount, const SearchLimits& budget, Output output);
+	~Server();
+	Server(const Server&) = delete;
+	Server& operator=(const Server&) = delete;
+
+	// Handles one input line. False for "quit".
+	bool handleLine(const std::string& line);
+	// Blocks until no search is queued or running.
+	void waitIdle();
+	size_t sessionCount();
+	// Every search uses this cache (see search_cache.h). Set it before the first line.
+	void setSearchCache(SearchCache* cache);
+
+private:
+	enum class SearchState { IDLE, QUEUED, RUNNING };
+
+	struct Session {
+		std::string id;
+		Board board;
+		PositionState position;
+		SearchLimits budget;
+		SearchState state = SearchState::IDLE;
+		std::unique_ptr<SearchContext> context; // only while a search is queued or running
+	};
+
+	void send(const std::string& id, const std::string& reply);
+	void workerLoop(int workerIndex);
+	void startSearch(const std::shared_ptr<Session>& session, const std::vector<std::string>& commandSegments);
+	// Stops the session's search and waits until its bestmove has been sent. Needs the lock.
+	void stopSearch(const std::shared_ptr<Session>& session, std::unique_lock<std::mutex>& lock);
+	void finishSearch(const std::shared_ptr<Session>& session, SearchContext& context, EvalCache& evalCache);
+
+	SearchLimits defaultBudget;
+	SearchCache* searchCache = nullptr;
+	Output output;
+	std::mutex outputMutex;
+
+	std::mutex mutex; // guards everything below
+	std::condition_variable workAvailable;
+	std::condition_variable searchDone;
+	std::map<std::string, std::shared_ptr<Session>> sessions;
+	std::deque<std::shared_ptr<Session>> queue;
+	int running = 0;
+	uint64_t searchesDone = 0;
+	bool shuttingDown = false;
+	std::vector<std::thread> workers;
+};
+
+int runServer(const std::vector<std::string>& args);
+
+#endif
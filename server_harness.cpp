@@ -0,0 +1,107 @@
+// Local client harness for the session server (server.h): runs a Server in-process, plays
+// a few moves in many sessions at once and checks that every search got exactly one legal
+// bestmove back. "bearbot-server-harness [sessions] [workers] [nodes] [moves]"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "server.h"
+#include "engine.h"
+#include "board.h"
+
+int main(int argc, char* argv[]) {
+	int sessionCount = (argc > 1) ? std::atoi(argv[1]) : 64;
+	int workerCount = (argc > 2) ? std::atoi(argv[2]) : 4;
+	int nodes = (argc > 3) ? std::atoi(argv[3]) : 2000;
+	int moveCount = (argc > 4) ? std::atoi(argv[4]) : 4;
+
+	std::mutex mutex;
+	std::map<std::string, std::vector<std::string>> bestMoves; // per session, in arrival order
+	std::vector<std::string> errors;
+	SearchLimits budget;
+	budget.nodes = 1000000;
+	Server server(workerCount, budget, [&](const std::string& line) {
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t space = line.find(' ');
+		std::string id = line.substr(0, space);
+		std::string reply = line.substr(space + 1);
+		if (reply.rfind("bestmove ", 0) == 0) {
+			bestMoves[id].push_back(reply.substr(9, reply.find(' ', 9) - 9));
+		} else if (reply.rfind("error", 0) == 0 || reply.rfind("info string", 0) == 0) {
+			errors.push_back(line);
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::string> ids;
+	std::vector<std::vector<std::string>> games(sessionCount);
+	for (int s = 0; s < sessionCount; s++) {
+		ids.push_back("s" + std::to_string(s));
+		server.handleLine(ids[s] + " open");
+		server.handleLine(ids[s] + " budget nodes " + std::to_string(nodes * 2));
+	}
+
+	// Every round: all sessions search their game at once, then play the move they got.
+	int failures = 0;
+	for (int move = 0; move < moveCount; move++) {
+		for (int s = 0; s < sessionCount; s++) {
+			std::string position = ids[s] + " position startpos moves";
+			for (const std::string& played : games[s]) {
+				position += " " + played;
+			}
+			server.handleLine(position);
+			// A different limit for every other session, so searches finish out of order.
+			server.handleLine(ids[s] + " go nodes " + std::to_string(s % 2 == 0 ? nodes : nodes / 2));
+		}
+		// Stopping a search that may still be queued must still answer with a bestmove.
+		server.handleLine(ids[0] + " stop");
+		server.waitIdle();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int s = 0; s < sessionCount; s++) {
+			std::vector<std::string>& moves = bestMoves[ids[s]];
+			if (moves.size() != 1) {
+				std::cout << ids[s] << ": expected 1 bestmove, got " << moves.size() << std::endl;
+				failures++;
+				moves.clear();
+				continue;
+			}
+			Board board;
+			for (const std::string& played : games[s]) {
+				board.pushMove(played);
+			}
+			std::vector<std::string> legal = generateLegalMoves(board);
+			if (std::find(legal.begin(), legal.end(), moves[0]) == legal.end()) {
+				std::cout << ids[s] << ": illegal bestmove " << moves[0] << std::endl;
+				failures++;
+			} else {
+				games[s].push_back(moves[0]);
+			}
+			moves.clear();
+		}
+	}
+
+	for (const std::string& id : ids) {
+		server.handleLine(id + " close");
+	}
+	if (server.sessionCount() != 0) {
+		std::cout << server.sessionCount() << " sessions left after closing all of them" << std::endl;
+		failures++;
+	}
+	for (const std::string& error : errors) {
+		std::cout << "unexpected reply: " << error << std::endl;
+		failures++;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	int searches = sessionCount * moveCount;
+	std::cout << searches << " searches in " << sessionCount << " sessions on " << workerCount << " workers, "
+	          << elapsed.count() << " seconds (" << searches / elapsed.count() << " searches/s)" << std::endl;
+	std::cout << (failures == 0 ? "OK" : "FAILED") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "timeman.h"
+
+TimeBudget allocateTime(int timeLeftMs, int incrementMs, int movesToGo) {
+	// In 64 bits: parseGoLimits lets clock values up to 1e9 ms through, and the sums and
+	// products below don't fit in an int then. The results are at most timeLeftMs.
+	TimeBudget budget;
+	int64_t available = std::max<int64_t>(1, static_cast<int64_t>(timeLeftMs) - MOVE_OVERHEAD_MS);
+	int64_t moves = (movesToGo > 0) ? std::min(movesToGo, 50) : DEFAULT_MOVES_TO_GO;
+
+	// The last move before the time control may use nearly everything, otherwise never
+	// more than a third of the clock on a single move.
+	int64_t maxMs = (moves == 1) ? available * 9 / 10 : available / 3;
+	int64_t softMs = available / moves + static_cast<int64_t>(incrementMs) * 3 / 4;
+	int64_t hardMs = std::max<int64_t>(1, std::min(softMs * 4, maxMs));
+	budget.hardMs = static_cast<int>(hardMs);
+	budget.softMs = static_cast<int>(std::max<int64_t>(1, std::min(softMs, hardMs)));
+	return budget;
+}
+
+void TimeManager::start(const TimeBudget& budget, int legalMoves) {
+	*this = TimeManager();
+	this->budget = budget;
+	this->legalMoves = legalMoves;
+}
+
+void TimeManager::iterationDone(int depth, const std::string& bestMove, int score, double bestMoveNodeShare) {
+	instability *= 0.5;
+	if (this->depth > 0 && bestMove != this->bestMove) {
+		instability += 1.0;
+	}
+	scoreDrop = (this->depth > 0) ? std::max(0, previousScore - score) : 0;
+	this->depth = depth;
+	this->bestMove = bestMove;
+	previousScore = score;
+	this->bestMoveNodeShare = bestMoveNodeShare;
+}
+
+int TimeManager::scaledSoftMs() const {
+	double scale = 1.0 + instability;                       // up to about 2x while the best move flips
+	scale *= 1.0 + std::min(scoreDrop, 100) / 200.0;         // up to 1.5x when the score falls
+	if (depth >= 5 && bestMoveNodeShare > 0.9) {
+		scale *= 0.5;                                        // one move clearly dominates
+	}
+	return static_cast<int>(std::min<double>(budget.hardMs, budget.softMs * scale));
+}
+
+bool TimeManager::stopAfterIteration(int elapsedMs) const {
+	if (budget.softMs <= 0) {
+		return false;
+	}
+	if (legalMoves == 1) {
+		return true; // nothing to think about
+	}
+	// The next iteration takes a few times as long as this one, don't start it if
+	// it can't plausibly finish before the scaled limit.
+	return elapsedMs >= static_cast<int64_t>(scaledSoftMs()) * 6 / 10;
+}
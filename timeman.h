@@ -0,0 +1,41 @@
+#ifndef TIMEMAN_H_
+#define TIMEMAN_H_
+
+#include <string>
+
+const int MOVE_OVERHEAD_MS = 30;      // kept back from every move for GUI and OS latency
+const int DEFAULT_MOVES_TO_GO = 30;   // moves we budget for when the time control is sudden death
+
+// Time for one move, in milliseconds. The search won't start a new iteration past the
+// soft limit (scaled by how settled the search looks) and is stopped at the hard limit.
+struct TimeBudget {
+	int softMs = 0;
+	int hardMs = 0;
+};
+
+// timeLeft and increment are our side's clock, movesToGo is 0 when there is no time control reset.
+TimeBudget allocateTime(int timeLeftMs, int incrementMs, int movesToGo);
+
+// Decides after each iteration whether another one is worth starting.
+//   - the soft limit grows when the best move keeps changing or the score drops,
+//   - and shrinks when the best move got almost all the nodes (e.g. an obvious recapture).
+class TimeManager {
+public:
+	void start(const TimeBudget& budget, int legalMoves);
+	// bestMoveNodes / totalNodes: share of the search spent below the best root move.
+	void iterationDone(int depth, const std::string& bestMove, int score, double bestMoveNodeShare);
+	bool stopAfterIteration(int elapsedMs) const;
+	int scaledSoftMs() const;
+
+private:
+	TimeBudget budget;
+	int legalMoves = 0;
+	int depth = 0;
+	std::string bestMove;
+	double instability = 0;    // decaying count of best move changes
+	int previousScore = 0;
+	int scoreDrop = 0;          // centipawns lost since the previous iteration
+	double bestMoveNodeShare = 0;
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include "trace.h"
+
+static const char TRACE_MAGIC[4] = {'B', 'B', 'T', 'R'};
+static const uint32_t TRACE_VERSION = 1;
+static const size_t TRACE_HEADER_BYTES = 16;
+static const size_t TRACE_RECORD_BYTES = 24;
+
+static void putLe(unsigned char* out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		out[i] = static_cast<unsigned char>(value >> (8 * i));
+	}
+}
+
+static uint64_t getLe(const unsigned char* in, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= static_cast<uint64_t>(in[i]) << (8 * i);
+	}
+	return value;
+}
+
+static void encodeRecord(unsigned char* out, const TraceRecord& record) {
+	out[0] = record.ply;
+	out[1] = record.depth;
+	out[2] = record.flags;
+	out[3] = record.cutoff;
+	putLe(out + 4, record.move, 2);
+	putLe(out + 6, record.thread, 2);
+	putLe(out + 8, static_cast<uint32_t>(record.alpha), 4);
+	putLe(out + 12, static_cast<uint32_t>(record.beta), 4);
+	putLe(out + 16, static_cast<uint32_t>(record.score), 4);
+	out[20] = record.moves;
+	out[21] = record.reductions;
+	out[22] = record.researches;
+	out[23] = 0;
+}
+
+static void decodeRecord(const unsigned char* in, TraceRecord& record) {
+	record.ply = in[0];
+	record.depth = in[1];
+	record.flags = in[2];
+	record.cutoff = in[3];
+	record.move = static_cast<uint16_t>(getLe(in + 4, 2));
+	record.thread = static_cast<uint16_t>(getLe(in + 6, 2));
+	record.alpha = static_cast<int32_t>(static_cast<uint32_t>(getLe(in + 8, 4)));
+	record.beta = static_cast<int32_t>(static_cast<uint32_t>(getLe(in + 12, 4)));
+	record.score = static_cast<int32_t>(static_cast<uint32_t>(getLe(in + 16, 4)));
+	record.moves = in[20];
+	record.reductions = in[21];
+	record.researches = in[22];
+}
+
+// --- Writing ---
+
+TraceLog::~TraceLog() {
+	close();
+}
+
+bool TraceLog::open(const std::string& path, std::string& error) {
+	close();
+	file = std::fopen(path.c_str(), "wb");
+	if (!file) {
+		error = "can't write " + path;
+		return false;
+	}
+	unsigned char header[TRACE_HEADER_BYTES] = {};
+	std::memcpy(header, TRACE_MAGIC, 4);
+	putLe(header + 4, TRACE_VERSION, 4);
+	putLe(header + 8, TRACE_RECORD_BYTES, 4);
+	std::fwrite(header, 1, sizeof(header), file);
+	closing = false;
+	written = 0;
+	writer = std::thread(&TraceLog::writerLoop, this);
+	return true;
+}
+
+void TraceLog::close() {
+	if (!file) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	hasWork.notify_all();
+	writer.join();
+	std::fclose(file);
+	file = nullptr;
+}
+
+std::vector<TraceRecord> TraceLog::submit(std::vector<TraceRecord>&& buffer) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!buffer.empty()) {
+		hasRoom.wait(lock, [&]() { return queue.size() < TRACE_MAX_QUEUED_BUFFERS || closing; });
+		queue.push_back(std::move(buffer));
+		hasWork.notify_one();
+	}
+	std::vector<TraceRecord> empty;
+	if (!spare.empty()) {
+		empty = std::move(spare.back());
+		spare.pop_back();
+	}
+	empty.clear();
+	empty.reserve(TRACE_BUFFER_RECORDS);
+	return empty;
+}
+
+void TraceLog::writerLoop() {
+	std::vector<unsigned char> bytes;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		hasWork.wait(lock, [&]() { return closing || !queue.empty(); });
+		if (queue.empty()) {
+			return; // closing and nothing left
+		}
+		std::vector<TraceRecord> buffer = std::move(queue.front());
+		queue.pop_front();
+		hasRoom.notify_all();
+		lock.unlock();
+
+		bytes.resize(buffer.size() * TRACE_RECORD_BYTES);
+		for (size_t i = 0; i < buffer.size(); i++) {
+			encodeRecord(&bytes[i * TRACE_RECORD_BYTES], buffer[i]);
+		}
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+		written += buffer.size();
+
+		lock.lock();
+		buffer.clear();
+		spare.push_back(std::move(buffer));
+	}
+}
+
+TraceWriter::TraceWriter(TraceLog& log) : log(log), id(log.newWriterId()) {
+	buffer.reserve(TRACE_BUFFER_RECORDS);
+}
+
+TraceWriter::~TraceWriter() {
+	flush();
+}
+
+void TraceWriter::flush() {
+	if (!buffer.empty()) {
+		buffer = log.submit(std::move(buffer));
+	}
+}
+
+// --- Reading ---
+
+struct TraceSummary {
+	static const int INDEX_BUCKETS = 12; // move index 0 .. 10, then 11 and later
+
+	uint64_t nodes = 0;
+	uint64_t qnodes = 0;
+	uint64_t inCheck = 0;
+	uint64_t cutoffs = 0;
+	uint64_t cutoffsByIndex[INDEX_BUCKETS] = {};
+	uint64_t nullTries = 0;
+	uint64_t nullCutoffs = 0;
+	uint64_t reductions = 0;
+	uint64_t researches = 0;
+	uint64_t movesSearched = 0;
+	uint64_t cacheCutoffs = 0;
+	uint64_t draws = 0;
+	uint64_t iterations = 0;
+	// Main search nodes by remaining depth: count, cutoffs, first move cutoffs
+	std::vector<uint64_t> depthNodes, depthCutoffs, depthFirstCutoffs;
+	int maxThread = -1;
+
+	void add(const TraceRecord& record) {
+		maxThread = std::max(maxThread, static_cast<int>(record.thread));
+		if (record.flags & TRACE_ITERATION) {
+			iterations++;
+			return;
+		}
+		nodes++;
+		if (record.flags & TRACE_QUIESCENCE) qnodes++;
+		if (record.flags & TRACE_IN_CHECK) inCheck++;
+		if (record.flags & TRACE_NULL_TRIED) nullTries++;
+		if (record.flags & TRACE_NULL_CUTOFF) nullCutoffs++;
+		if (record.flags & TRACE_CACHE_CUTOFF) cacheCutoffs++;
+		if (record.flags & TRACE_DRAW) draws++;
+		reductions += record.reductions;
+		researches += record.researches;
+		movesSearched += record.moves;
+		if (record.cutoff != TRACE_NO_CUTOFF) {
+			cutoffs++;
+			cutoffsByIndex[std::min<int>(record.cutoff, INDEX_BUCKETS - 1)]++;
+		}
+		if (!(record.flags & TRACE_QUIESCENCE)) {
+			if (record.depth >= depthNodes.size()) {
+				depthNodes.resize(record.depth + 1);
+				depthCutoffs.resize(record.depth + 1);
+				depthFirstCutoffs.resize(record.depth + 1);
+			}
+			depthNodes[record.depth]++;
+			if (record.cutoff != TRACE_NO_CUTOFF) {
+				depthCutoffs[record.depth]++;
+				if (record.cutoff == 0) {
+					depthFirstCutoffs[record.depth]++;
+				}
+			}
+		}
+	}
+};
+
+static double percent(uint64_t part, uint64_t whole) {
+	return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+static void printSummary(const TraceSummary& summary) {
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Nodes: " << summary.nodes << " (" << summary.qnodes << " quiescence, " << percent(summary.qnodes, summary.nodes) << "%)"
+	          << ", threads " << (summary.maxThread + 1) << ", iterations " << summary.iterations << std::endl;
+	std::cout << "In check: " << summary.inCheck << ", draws: " << summary.draws << ", search cache cutoffs: " << summary.cacheCutoffs << std::endl;
+	std::cout << "Null move: " << summary.nullTries << " tries, " << summary.nullCutoffs << " cutoffs ("
+	          << percent(summary.nullCutoffs, summary.nullTries) << "%)" << std::endl;
+	std::cout << "LMR: " << summary.reductions << " reductions (" << percent(summary.reductions, summary.movesSearched)
+	          << "% of moves searched), " << summary.researches << " re-searches (" << percent(summary.researches, summary.reductions) << "%)" << std::endl;
+
+	std::cout << "Cutoffs: " << summary.cutoffs << " by move index" << std::endl;
+	uint64_t cumulative = 0;
+	for (int i = 0; i < TraceSummary::INDEX_BUCKETS; i++) {
+		cumulative += summary.cutoffsByIndex[i];
+		std::cout << "  " << std::setw(3) << (i + 1 < TraceSummary::INDEX_BUCKETS ? std::to_string(i) : std::to_string(i) + "+")
+		          << std::setw(12) << summary.cutoffsByIndex[i]
+		          << std::setw(7) << percent(summary.cutoffsByIndex[i], summary.cutoffs) << "%"
+		          << "  cumulative " << std::setw(5) << percent(cumulative, summary.cutoffs) << "%" << std::endl;
+	}
+
+	std::cout << "By remaining depth (main search):" << std::endl;
+	std::cout << "  depth        nodes     cutoffs  first move" << std::endl;
+	for (size_t depth = 1; depth < summary.depthNodes.size(); depth++) {
+		if (summary.depthNodes[depth] == 0) {
+			continue;
+		}
+		std::cout << "  " << std::setw(5) << depth << std::setw(13) << summary.depthNodes[depth]
+		          << std::setw(11) << percent(summary.depthCutoffs[depth], summary.depthNodes[depth]) << "%"
+		          << std::setw(11) << percent(summary.depthFirstCutoffs[depth], summary.depthCutoffs[depth]) << "%" << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+int runTrace(const std::vector<std::string>& args) {
+	std::string path;
+	int thread = -1;
+	for (size_t i = 0; i < args.size(); i++) {
+		bool hasValue = i + 1 < args.size();
+		if (args[i] == "--thread" && hasValue) thread = std::atoi(args[++i].c_str());
+		else if (path.empty() && args[i].rfind("--", 0) != 0) path = args[i];
+		else {
+			std::cerr << "Unknown trace option: " << args[i] << std::endl;
+			return 1;
+		}
+	}
+	if (path.empty()) {
+		std::cerr << "Usage: bearbot trace <trace.bin> [--thread N]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream input(path, std::ios::binary);
+	unsigned char header[TRACE_HEADER_BYTES];
+	if (!input.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		std::cerr << "Can't read " << path << std::endl;
+		return 1;
+	}
+	if (std::memcmp(header, TRACE_MAGIC, 4) != 0 || getLe(header + 4, 4) != TRACE_VERSION || getLe(header + 8, 4) != TRACE_RECORD_BYTES) {
+		std::cerr << path << " is not a BearBot trace (or one of another version)" << std::endl;
+		return 1;
+	}
+
+	TraceSummary summary;
+	std::vector<unsigned char> buffer(TRACE_RECORD_BYTES * 65536);
+	while (input) {
+		input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		size_t records = static_cast<size_t>(input.gcount()) / TRACE_RECORD_BYTES;
+		for (size_t r = 0; r < records; r++) {
+			TraceRecord record;
+			decodeRecord(&buffer[r * TRACE_RECORD_BYTES], record);
+			if (thread < 0 || record.thread == thread) {
+				summary.add(record);
+			}
+		}
+	}
+	printSummary(summary);
+	return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Search tree traces, for seeing what the search did when tuning pruning and move ordering:
+// one record per node, written to a binary log and summarized by "bearbot trace <file>".
+//
+// Every search thread collects records in its own TraceWriter, which hands full buffers
+// over to the TraceLog. The log's own thread encodes and writes them, so the search only
+// pays for filling in a struct. A search without a writer (the default) pays one branch
+// per node.
+//
+// File layout, little endian: a 16 byte header ("BBTR", version, record size, 0), then
+// 24 byte records. A node's record is written when the node returns, children before
+// their parent:
+//   0  uint8  ply
+//   1  uint8  depth       remaining depth, 0 in quiescence; the depth for TRACE_ITERATION
+//   2  uint8  flags       TRACE_*
+//   3  uint8  cutoff      index of the move that failed high, 255 if none did
+//   4  uint16 move        the move that led here (encoded as in search_cache.h), 0 at the root
+//   6  uint16 thread      writer number, records of different threads are interleaved
+//   8  int32  alpha       the window the node was called with
+//   12 int32  beta
+//   16 int32  score       what the node returned
+//   20 uint8  moves       moves searched
+//   21 uint8  reductions  late move reductions among them
+//   22 uint8  researches  reduced moves that had to be searched again
+//   23 uint8  0
+enum TraceFlags : uint8_t {
+	TRACE_IN_CHECK = 1,
+	TRACE_QUIESCENCE = 2,
+	TRACE_NULL_TRIED = 4,
+	TRACE_NULL_CUTOFF = 8,
+	TRACE_CACHE_CUTOFF = 16, // answered by the search cache
+	TRACE_DRAW = 32,         // repetition or fifty move rule
+	TRACE_ITERATION = 128    // not a node: the root finished an iteration (move = best move)
+};
+
+const uint8_t TRACE_NO_CUTOFF = 255;
+const size_t TRACE_BUFFER_RECORDS = 4096;
+const size_t TRACE_MAX_QUEUED_BUFFERS = 64; // a search thread waits when the writer is this far behind
+
+struct TraceRecord {
+	uint8_t ply;
+	uint8_t depth;
+	uint8_t flags;
+	uint8_t cutoff;
+	uint16_t move;
+	uint16_t thread;
+	int32_t alpha;
+	int32_t beta;
+	int32_t score;
+	uint8_t moves;
+	uint8_t reductions;
+	uint8_t researches;
+};
+
+// The file and the thread that writes it. Shared by every TraceWriter that logs to it.
+class TraceLog {
+public:
+	TraceLog() = default;
+	~TraceLog();
+	TraceLog(const TraceLog&) = delete;
+	TraceLog& operator=(const TraceLog&) = delete;
+
+	bool open(const std::string& path, std::string& error); // truncates the file
+	void close(); // writes everything submitted so far
+	bool isOpen() const { return file != nullptr; }
+
+	uint16_t newWriterId() { return static_cast<uint16_t>(writerIds++); }
+	// Queues a full buffer and returns an empty one to fill next.
+	std::vector<TraceRecord> submit(std::vector<TraceRecord>&& buffer);
+	uint64_t recordsWritten() const { return written; }
+
+private:
+	void writerLoop();
+
+	FILE* file = nullptr;
+	std::thread writer;
+	std::atomic<int> writerIds{0};
+	std::atomic<uint64_t> written{0};
+
+	std::mutex mutex; // guards everything below
+	std::condition_variable hasWork;
+	std::condition_variable hasRoom;
+	std::deque<std::vector<TraceRecord>> queue;
+	std::vector<std::vector<TraceRecord>> spare; // written buffers, reused
+	bool closing = false;
+};
+
+// One search thread's side of the log.
+class TraceWriter {
+public:
+	explicit TraceWriter(TraceLog& log);
+	~TraceWriter();
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	// The move about to be searched at ply, so the child knows how it was reached.
+	void setMove(int ply, uint16_t move) { path[ply] = move; }
+	uint16_t moveTo(int ply) const { return ply > 0 ? path[ply] : 0; }
+
+	void add(const TraceRecord& record) {
+		buffer.push_back(record);
+		buffer.back().thread = id;
+		if (buffer.size() >= TRACE_BUFFER_RECORDS) {
+			buffer = log.submit(std::move(buffer));
+		}
+	}
+	void flush(); // hands over a partly filled buffer
+
+private:
+	TraceLog& log;
+	uint16_t id;
+	std::vector<TraceRecord> buffer;
+	uint16_t path[256] = {};
+};
+
+// "bearbot trace <file> [--thread N]": statistics of a trace log.
+int runTrace(const std::vector<std::string>& args);
+
+#endif
@@ -0,0 +1,449 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "tune.h"
+#include "datagen.h"
+#include "eval_params.h"
+#include "numa.h"
+
+// Parameter layout: the five tunable piece values, then the 6x64 piece-square tables.
+static const int VALUE_PARAMS = 5;
+static const int NUM_PARAMS = VALUE_PARAMS + 6 * 64;
+static const size_t BLOCK = 256; // positions evaluated together before the gradient is scattered
+
+static const char* PIECE_NAMES[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+// The positions are read by every thread on every epoch, so on a multi-socket machine their
+// pages are spread over all nodes instead of all sitting next to the thread that loaded them.
+template <typename T>
+using SharedVector = std::vector<T, InterleavedAllocator<T>>;
+
+// Every position as a list of pieces, each packed into 16 bits: bit 9 black, bits 6-8
+// the piece type (0 pawn .. 5 king), bits 0-5 the square from that piece's own point of
+// view (already mirrored for black, so it indexes PIECE_SQUARE directly).
+struct TuneSet {
+	SharedVector<uint32_t> offsets = {0}; // pieces of position i are entries[offsets[i] .. offsets[i + 1])
+	SharedVector<uint16_t> entries;
+	SharedVector<float> results;         // 0, 0.5 or 1 for white
+	SharedVector<float> scores;          // search score for white, NAN when the file had none
+
+	size_t size() const { return results.size(); }
+
+	void addPiece(int code, int square) {
+		int type = code % 6;
+		bool black = code >= 6;
+		entries.push_back(static_cast<uint16_t>((black ? 1 << 9 : 0) | (type << 6) | (black ? square ^ 56 : square)));
+	}
+	void endPosition(float result, float score) {
+		offsets.push_back(static_cast<uint32_t>(entries.size()));
+		results.push_back(result);
+		scores.push_back(score);
+	}
+};
+
+static bool loadPacked(const std::string& path, TuneSet& set) {
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		return false;
+	}
+	std::vector<unsigned char> buffer(PACKED_POSITION_BYTES * 4096);
+	while (input) {
+		input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		size_t records = static_cast<size_t>(input.gcount()) / PACKED_POSITION_BYTES;
+		for (size_t r = 0; r < records; r++) {
+			PackedPosition position;
+			if (!readPackedPosition(&buffer[r * PACKED_POSITION_BYTES], position)) {
+				continue;
+			}
+			int count = 0;
+			for (int square = 0; square < 64; square++) {
+				if (position.occupancy & (1ULL << square)) {
+					int code = (count % 2 == 0) ? position.pieces[count / 2] & 0xF : position.pieces[count / 2] >> 4;
+					set.addPiece(code, square);
+					count++;
+				}
+			}
+			set.endPosition(position.result / 2.0f, position.score);
+		}
+	}
+	return true;
+}
+
+static const std::string PIECE_LETTERS = "PNBRQKpnbrqk";
+
+// "<fen> | <score> | <result>" or "<fen> | <result>"
+static bool parseTextLine(const std::string& line, TuneSet& set) {
+	std::vector<std::string> fields;
+	std::stringstream ss(line);
+	std::string field;
+	while (std::getline(ss, field, '|')) {
+		fields.push_back(field);
+	}
+	if (fields.size() < 2 || fields.size() > 3) {
+		return false;
+	}
+	float result = std::strtof(fields.back().c_str(), nullptr);
+	float score = (fields.size() == 3) ? std::strtof(fields[1].c_str(), nullptr) : NAN;
+
+	size_t start = fields[0].find_first_not_of(' ');
+	if (start == std::string::npos) {
+		return false;
+	}
+	size_t before = set.entries.size();
+	int square = 0;
+	for (size_t i = start; i < fields[0].size() && fields[0][i] != ' '; i++) {
+		char ch = fields[0][i];
+		if (ch == '/') {
+			continue;
+		}
+		if (ch >= '1' && ch <= '8') {
+			square += ch - '0';
+			continue;
+		}
+		size_t code = PIECE_LETTERS.find(ch);
+		if (code == std::string::npos || square >= 64) {
+			set.entries.resize(before);
+			return false;
+		}
+		set.addPiece(static_cast<int>(code), square++);
+	}
+	if (square != 64) {
+		set.entries.resize(before);
+		return false;
+	}
+	set.endPosition(result, score);
+	return true;
+}
+
+static bool loadText(const std::string& path, TuneSet& set) {
+	std::ifstream input(path);
+	if (!input) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(input, line)) {
+		parseTextLine(line, set);
+	}
+	return true;
+}
+
+static inline double sigmoid(double k, double eval) {
+	return 1.0 / (1.0 + std::exp(-k * eval / 400.0));
+}
+
+// The tuner's threads, started and pinned once for the whole run. Each owns a gradient
+// buffer, allocated after it is pinned so it sits on that thread's node. run() hands every
+// thread the same job and returns when all of them have finished it.
+class TunePool {
+public:
+	explicit TunePool(int threadCount) : gradients(threadCount) {
+		for (int t = 0; t < threadCount; t++) {
+			threads.emplace_back(&TunePool::loop, this, t);
+		}
+	}
+
+	~TunePool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	int size() const { return static_cast<int>(threads.size()); }
+	const std::vector<double>& gradient(int t) const { return gradients[t]; }
+
+	// work(t, gradient) on every thread t, with gradient the buffer of that thread.
+	void run(const std::function<void(int, std::vector<double>&)>& work) {
+		std::unique_lock<std::mutex> lock(mutex);
+		job = &work;
+		running = size();
+		generation++;
+		wake.notify_all();
+		done.wait(lock, [this] { return running == 0; });
+		job = nullptr;
+	}
+
+private:
+	void loop(int t) {
+		pinWorkerThread(t);
+		gradients[t].assign(NUM_PARAMS, 0.0);
+		uint64_t seen = 0;
+		while (true) {
+			const std::function<void(int, std::vector<double>&)>* work;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return quit || generation != seen; });
+				if (quit) {
+					return;
+				}
+				seen = generation;
+				work = job;
+			}
+			(*work)(t, gradients[t]);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0) {
+				done.notify_one();
+			}
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::vector<std::vector<double>> gradients;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int, std::vector<double>&)>* job = nullptr;
+	uint64_t generation = 0;
+	int running = 0;
+	bool quit = false;
+};
+
+// Mean squared error of sigmoid(k * eval) against targets over all positions. When gradient
+// isn't null it receives d(loss)/d(param) for every parameter.
+static double computeLoss(TunePool& pool, const TuneSet& set, const std::vector<double>& params, const SharedVector<float>& targets,
+                          double k, std::vector<double>* gradient) {
+	int threadCount = pool.size();
+	std::vector<double> losses(threadCount, 0.0);
+	size_t n = set.size();
+	size_t chunk = (n + threadCount - 1) / threadCount;
+
+	pool.run([&](int t, std::vector<double>& grad) {
+		size_t begin = std::min(n, t * chunk);
+		size_t end = std::min(n, begin + chunk);
+		if (gradient) {
+			std::fill(grad.begin(), grad.end(), 0.0);
+		}
+		double evals[BLOCK];
+		double slopes[BLOCK];
+		double loss = 0;
+		for (size_t blockStart = begin; blockStart < end; blockStart += BLOCK) {
+			size_t count = std::min(BLOCK, end - blockStart);
+			// 1. Gather: evaluate the block
+			for (size_t j = 0; j < count; j++) {
+				size_t i = blockStart + j;
+				double eval = 0;
+				for (uint32_t e = set.offsets[i]; e < set.offsets[i + 1]; e++) {
+					uint16_t entry = set.entries[e];
+					int type = (entry >> 6) & 7;
+					double value = params[VALUE_PARAMS + type * 64 + (entry & 63)] + (type < VALUE_PARAMS ? params[type] : 0.0);
+					eval += (entry & (1 << 9)) ? -value : value;
+				}
+				evals[j] = eval;
+			}
+			// 2. Loss and d(loss)/d(eval), straight over the arrays
+			for (size_t j = 0; j < count; j++) {
+				double s = sigmoid(k, evals[j]);
+				double error = s - targets[blockStart + j];
+				loss += error * error;
+				slopes[j] = 2.0 * error * s * (1.0 - s) * k / 400.0;
+			}
+			// 3. Scatter the slopes onto the parameters each position uses
+			if (gradient) {
+				for (size_t j = 0; j < count; j++) {
+					size_t i = blockStart + j;
+					for (uint32_t e = set.offsets[i]; e < set.offsets[i + 1]; e++) {
+						uint16_t entry = set.entries[e];
+						int type = (entry >> 6) & 7;
+						double slope = (entry & (1 << 9)) ? -slopes[j] : slopes[j];
+						grad[VALUE_PARAMS + type * 64 + (entry & 63)] += slope;
+						if (type < VALUE_PARAMS) {
+							grad[type] += slope;
+						}
+					}
+				}
+			}
+		}
+		losses[t] = loss;
+	});
+
+	double loss = 0;
+	for (double l : losses) loss += l;
+	if (gradient) {
+		gradient->assign(NUM_PARAMS, 0.0);
+		for (int t = 0; t < threadCount; t++) {
+			const std::vector<double>& grad = pool.gradient(t);
+			for (int p = 0; p < NUM_PARAMS; p++) {
+				(*gradient)[p] += grad[p] / n;
+			}
+		}
+	}
+	return loss / n;
+}
+
+static SharedVector<float> makeTargets(const TuneSet& set, double k, double lambda) {
+	SharedVector<float> targets(set.size());
+	for (size_t i = 0; i < set.size(); i++) {
+		double target = set.results[i];
+		if (!std::isnan(set.scores[i])) {
+			target = lambda * set.results[i] + (1.0 - lambda) * sigmoid(k, set.scores[i]);
+		}
+		targets[i] = static_cast<float>(target);
+	}
+	return targets;
+}
+
+// Golden section search for the k that best maps the current evaluation onto the game results.
+static double fitK(TunePool& pool, const TuneSet& set, const std::vector<double>& params) {
+	const SharedVector<float>& results = set.results;
+	const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+	double lo = 0.05, hi = 10.0;
+	double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+	double lossA = computeLoss(pool, set, params, results, a, nullptr);
+	double lossB = computeLoss(pool, set, params, results, b, nullptr);
+	for (int i = 0; i < 30; i++) {
+		if (lossA < lossB) {
+			hi = b; b = a; lossB = lossA;
+			a = hi - ratio * (hi - lo);
+			lossA = computeLoss(pool, set, params, results, a, nullptr);
+		} else {
+			lo = a; a = b; lossA = lossB;
+			b = lo + ratio * (hi - lo);
+			lossB = computeLoss(pool, set, params, results, b, nullptr);
+		}
+	}
+	return (lo + hi) / 2;
+}
+
+static bool writeParams(const std::string& path, const std::vector<double>& params) {
+	std::ofstream out(path);
+	if (!out) {
+		return false;
+	}
+	out << "#ifndef EVAL_PARAMS_H_\n#define EVAL_PARAMS_H_\n\n"
+	    << "// Evaluation parameters in centipawns. \"bearbot tune\" writes a new version of this file (see tune.h).\n\n"
+	    << "// pawn, knight, bishop, rook, queen, king. The king's value only has to dwarf everything\n"
+	    << "// else, both sides always have one, so it is never tuned.\n"
+	    << "const int PIECE_VALUES[6] = {";
+	for (int type = 0; type < VALUE_PARAMS; type++) {
+		out << static_cast<int>(std::lround(params[type])) << ", ";
+	}
+	out << PIECE_VALUES[5] << "};\n\n"
+	    << "// Bonus for a piece on a square, from white's point of view: square 0 is a8, 63 is h1.\n"
+	    << "// Black pieces use the mirrored square (square ^ 56).\n"
+	    << "const int PIECE_SQUARE[6][64] = {\n";
+	for (int type = 0; type < 6; type++) {
+		out << "\t{ // " << PIECE_NAMES[type] << "\n";
+		for (int row = 0; row < 8; row++) {
+			out << "\t\t";
+			for (int col = 0; col < 8; col++) {
+				out << std::setw(4) << std::lround(params[VALUE_PARAMS + type * 64 + row * 8 + col]) << (row < 7 || col < 7 ? "," : "");
+			}
+			out << "\n";
+		}
+		out << "\t}" << (type < 5 ? "," : "") << "\n";
+	}
+	out << "};\n\n#endif\n";
+	return true;
+}
+
+int runTune(const std::vector<std::string>& args) {
+	std::string inputPath;
+	std::string outputPath = "eval_params.tuned.h";
+	int epochs = 200;
+	int threadCount = 0;
+	double learningRate = 2.0;
+	double k = 0;
+	double lambda = 1.0;
+	for (size_t i = 0; i < args.size(); i++) {
+		bool hasValue = i + 1 < args.size();
+		if (args[i] == "--epochs" && hasValue) epochs = std::atoi(args[++i].c_str());
+		else if (args[i] == "--threads" && hasValue) threadCount = std::atoi(args[++i].c_str());
+		else if (args[i] == "--lr" && hasValue) learningRate = std::atof(args[++i].c_str());
+		else if (args[i] == "--k" && hasValue) k = std::atof(args[++i].c_str());
+		else if (args[i] == "--lambda" && hasValue) lambda = std::atof(args[++i].c_str());
+		else if (args[i] == "--output" && hasValue) outputPath = args[++i];
+		else if (inputPath.empty() && args[i].rfind("--", 0) != 0) inputPath = args[i];
+		else {
+			std::cerr << "Unknown tune option: " << args[i] << std::endl;
+			return 1;
+		}
+	}
+	if (inputPath.empty()) {
+		std::cerr << "Usage: bearbot tune <positions.bin|positions.txt> [--epochs N] [--threads N] [--lr X] [--k X] [--lambda X] [--output FILE]" << std::endl;
+		return 1;
+	}
+	if (threadCount < 1) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	TuneSet set;
+	bool packed = inputPath.size() > 4 && inputPath.compare(inputPath.size() - 4, 4, ".bin") == 0;
+	if (!(packed ? loadPacked(inputPath, set) : loadText(inputPath, set))) {
+		std::cerr << "Can't open " << inputPath << std::endl;
+		return 1;
+	}
+	if (set.size() == 0) {
+		std::cerr << "No positions in " << inputPath << std::endl;
+		return 1;
+	}
+	std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - start;
+	std::cout << "Loaded " << set.size() << " positions (" << (set.entries.size() * sizeof(uint16_t) + set.size() * 12) / (1024 * 1024)
+	          << " MB) in " << loadTime.count() << " seconds" << std::endl;
+
+	std::vector<double> params(NUM_PARAMS);
+	for (int type = 0; type < VALUE_PARAMS; type++) {
+		params[type] = PIECE_VALUES[type];
+	}
+	for (int type = 0; type < 6; type++) {
+		for (int square = 0; square < 64; square++) {
+			params[VALUE_PARAMS + type * 64 + square] = PIECE_SQUARE[type][square];
+		}
+	}
+
+	TunePool pool(threadCount);
+	if (k <= 0) {
+		k = fitK(pool, set, params);
+	}
+	SharedVector<float> targets = makeTargets(set, k, lambda);
+	std::cout << "K " << k << ", starting loss " << computeLoss(pool, set, params, targets, k, nullptr) << std::endl;
+
+	// Adam
+	const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+	std::vector<double> m(NUM_PARAMS, 0.0), v(NUM_PARAMS, 0.0), gradient;
+	for (int epoch = 1; epoch <= epochs; epoch++) {
+		auto epochStart = std::chrono::steady_clock::now();
+		double loss = computeLoss(pool, set, params, targets, k, &gradient);
+		for (int p = 0; p < NUM_PARAMS; p++) {
+			m[p] = beta1 * m[p] + (1 - beta1) * gradient[p];
+			v[p] = beta2 * v[p] + (1 - beta2) * gradient[p] * gradient[p];
+			double mHat = m[p] / (1 - std::pow(beta1, epoch));
+			double vHat = v[p] / (1 - std::pow(beta2, epoch));
+			params[p] -= learningRate * mHat / (std::sqrt(vHat) + epsilon);
+		}
+		std::chrono::duration<double> epochTime = std::chrono::steady_clock::now() - epochStart;
+		if (epoch == 1 || epoch % 10 == 0 || epoch == epochs) {
+			std::cout << "epoch " << epoch << " loss " << std::setprecision(8) << loss << std::setprecision(6)
+			          << " (" << static_cast<uint64_t>(set.size() / std::max(epochTime.count(), 1e-9)) << " positions/s)"
+			          << " values";
+			for (int type = 0; type < VALUE_PARAMS; type++) {
+				std::cout << " " << std::lround(params[type]);
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	if (!writeParams(outputPath, params)) {
+		std::cerr << "Can't write " << outputPath << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << outputPath << ", copy it over eval_params.h and rebuild to use it" << std::endl;
+	return 0;
+}
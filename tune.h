@@ -0,0 +1,24 @@
+#ifndef TUNE_H_
+#define TUNE_H_
+
+#include <string>
+#include <vector>
+
+// Texel tuning of the evaluation parameters in eval_params.h: "bearbot tune <positions> [options]"
+//
+//   <positions>         packed positions from "bearbot datagen" (*.bin), or text lines of
+//                       "<fen> | <score> | <result>" or "<fen> | <result>" (result 1.0, 0.5, 0.0 for white)
+//   --epochs N          passes over the data (default 200)
+//   --threads N         default: all cores
+//   --lr X              Adam learning rate in centipawns (default 2)
+//   --k X               sigmoid scale, fitted to the starting parameters if not given
+//   --lambda X          weight of the game result against the search score (default 1, result only)
+//   --output FILE       where the tuned eval_params.h is written (default eval_params.tuned.h)
+//
+// The evaluation is linear in its parameters, so every position is stored as a short list of
+// (piece, square) entries and the loss gradient is a sum over those entries. Each thread
+// works on its own slice of the positions with its own gradient, the slices are added up
+// once per epoch. The threads are started once and kept for the whole run.
+int runTune(const std::vector<std::string>& args);
+
+#endif
@@ -2,10 +2,18 @@
 #include <string>
 #include <vector>
 #include <sstream>
-#include <ctime>
+#include <algorithm>
+#include <cstdlib>
 #include "uci.h"
 #include "board.h"
 #include "engine.h"
+#include "engine_api.h"
+#include "search.h"
+#include "timeman.h"
+#include "cpu.h"
+#include "numa.h"
+#include "search_cache.h"
+#include "profile.h"
 
 std::vector<std::string> parseCommand(std::string command) {
 	std::vector<std::string> splitCommand;
@@ -17,13 +25,89 @@ std::vector<std::string> parseCommand(std::string command) {
 	return splitCommand;
 }
 
-int main() {
-	srand(static_cast<unsigned int>(time(NULL))); // Add the static_cast
+bool parsePositionCommand(const std::vector<std::string>& commandSegments, std::string& base, std::vector<std::string>& moves) {
+	if (commandSegments.size() < 2) {
+		return false;
+	}
+
+	// Split the command into the base position and the list of moves after it.
+	base.clear();
+	moves.clear();
+	size_t i = 2;
+	if (commandSegments[1] == "startpos") {
+		base = "startpos";
+	} else if (commandSegments[1] == "fen") {
+		while (i < commandSegments.size() && commandSegments[i] != "moves") {
+			base += (base.empty() ? "" : " ") + commandSegments[i];
+			i++;
+		}
+	} else {
+		return false;
+	}
+	if (i < commandSegments.size() && commandSegments[i] == "moves") {
+		moves.assign(commandSegments.begin() + i + 1, commandSegments.end());
+	}
+	return true;
+}
+
+SearchLimits parseGoLimits(const std::vector<std::string>& commandSegments, PieceColor sideToMove, bool& ponder) {
+	SearchLimits limits;
+	int timeLeft[2] = {-1, -1}; // white, black
+	int increment[2] = {0, 0};
+	int movesToGo = 0;
+	bool depthGiven = false;
+	ponder = false;
+	for (size_t i = 1; i < commandSegments.size(); i++) {
+		const std::string& name = commandSegments[i];
+		if (name == "ponder") {
+			ponder = true;
+			continue;
+		}
+		if (name == "infinite") {
+			limits.infinite = true;
+			continue;
+		}
+		if (i + 1 >= commandSegments.size()) {
+			break;
+		}
+		long long value = std::atoll(commandSegments[i + 1].c_str());
+		int ms = static_cast<int>(std::max(0LL, std::min(value, 1000000000LL)));
+		if (name == "wtime") timeLeft[0] = ms;
+		else if (name == "btime") timeLeft[1] = ms;
+		else if (name == "winc") increment[0] = ms;
+		else if (name == "binc") increment[1] = ms;
+		else if (name == "movestogo") movesToGo = ms;
+		else if (name == "depth") { limits.depth = std::max(1, std::min(ms, MAX_PLY - 1)); depthGiven = true; }
+		else if (name == "nodes") limits.nodes = static_cast<uint64_t>(std::max(0LL, value));
+		else if (name == "movetime") limits.movetime = std::max(1, ms);
+		else if (name == "mate") limits.mate = ms;
+		else continue;
+		i++;
+	}
+
+	int us = (sideToMove == PieceColor::WHITE) ? 0 : 1;
+	if (timeLeft[us] >= 0) {
+		limits.time = allocateTime(timeLeft[us], increment[us], movesToGo);
+	}
+	// Any limit other than depth means: deepen until that limit stops us.
+	if (!depthGiven && (limits.infinite || limits.nodes > 0 || limits.movetime > 0 || limits.time.hardMs > 0)) {
+		limits.depth = MAX_PLY - 1;
+	}
+	return limits;
+}
+
+int runUci() {
 	bool isRunning = true;
-	Board board;
+	Engine engine;
+	std::shared_ptr<SearchCache> searchCache;
+	int searchCacheMB = SEARCH_CACHE_DEFAULT_MB;
+	std::shared_ptr<TraceLog> traceLog;
+	engine.setUciOutput(true);
 	while (isRunning) {
 		std::string command;
-		getline(std::cin, command);
+		if (!getline(std::cin, command)) {
+			command = "quit"; // the GUI went away
+		}
 		std::vector<std::string> commandSegments = parseCommand(command);
 
 		
@@ -32,72 +116,154 @@ int main() {
 		}
 		
 		if (commandSegments[0] == "uci") {
-			std::cout << "id name BearBot\n"
-				 << "id author Trevor Coppess\n"
-			     << "uciok" << std::endl;
+			uciWrite("id name BearBot\n"
+				 "id author Trevor Coppess\n"
+				 "option name Ponder type check default false\n"
+				 "option name MultiPV type spin default 1 min 1 max 256\n"
+				 "option name Affinity type combo default auto var auto var none var compact var spread\n"
+				 "option name SearchCache type string default <empty>\n"
+				 "option name SearchCacheMB type spin default " + std::to_string(SEARCH_CACHE_DEFAULT_MB) + " min 1 max 65536\n"
+				 "option name TraceFile type string default <empty>\n"
+			     "uciok");
+		} else if (commandSegments[0] == "debug") {
+			engine.setDebug(commandSegments.size() > 1 && commandSegments[1] == "on");
 		} else if (commandSegments[0] == "isready") {
-			std::cout << "readyok" << std::endl;
+			uciWrite("readyok");
 		} else if (commandSegments[0] == "position") {
-			// I don't think I will need this implementation right away, so I will save it for later.
-            // Example: "position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 moves e2e4"
-            
-            
-            // I think that this is the main sting of this command, so this is where I will start.
-            // Example: "position startpos moves e2e4 e7e5"
-            if (commandSegments.size() > 1 && commandSegments[1] == "startpos") {
-            	board.initializeBoard();
-            	if (commandSegments.size() > 2 && commandSegments[2] == "moves") {
-            		if (commandSegments.size() > 3) {
-            			for (int i = 3; i < commandSegments.size(); i++) {
-            				board.pushMove(commandSegments[i]);
-						}
-					}
-				}
+			// Examples:
+			// "position startpos moves e2e4 e7e5"
+			// "position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 moves e2e4"
+			std::string base;
+			std::vector<std::string> moves;
+			if (parsePositionCommand(commandSegments, base, moves) && !engine.setPosition(base, moves)) {
+				uciWrite("info string invalid position: " + command);
 			}
 		} else if (commandSegments[0] == "ucinewgame") {
-			board.initializeBoard();
-			std::cout << "info new game initialized" << std::endl;
+			engine.newGame();
+			uciWrite("info new game initialized");
 		} else if (commandSegments[0] == "go") {
-			// I don't think I will need this implementation right away, so I will save it for later.
 			// This is where your engine starts thinking.
             // Examples:
             // "go movetime 5000"
             // "go depth 5"
             // "go infinite"
-            
-            
-			// I think that this is the main string of this command, so this is where I will start.
-			// "go wtime 300000 btime 300000 winc 2000 binc 2000"
-			if (commandSegments.size() >= 2 && commandSegments[1] == "wtime") {
-				board.setWTime(std::stoi(commandSegments[2]));
-			}
-			if (commandSegments.size() >= 4 && commandSegments[3] == "btime") {
-				board.setBTime(std::stoi(commandSegments[4]));
-			}
-			if (commandSegments.size() >= 6 && commandSegments[5] == "winc") {
-				board.setWInc(std::stoi(commandSegments[6]));
-			}
-			if (commandSegments.size() >= 8 && commandSegments[7] == "binc") {
-				board.setBInc(std::stoi(commandSegments[8]));
+            // "go wtime 300000 btime 300000 winc 2000 binc 2000 movestogo 40"
+			engine.stop();
+			bool ponder = false;
+			SearchLimits limits = parseGoLimits(commandSegments, engine.board().getCurrentPlayer(), ponder);
+
+			// 3. If there are legal moves, find the best one and send it. The search runs on its own
+			// thread so "stop" and "ponderhit" can reach it while it thinks.
+			engine.go(limits, [](const SearchResult& result) {
+				std::string line = "bestmove " + (result.bestMove.empty() ? std::string("0000") : result.bestMove);
+				if (result.pv.size() > 1) {
+					line += " ponder " + result.pv[1];
+				}
+				uciWrite(line);
+			}, nullptr, ponder);
+		} else if (commandSegments[0] == "stop") {
+			engine.stop();
+		} else if (commandSegments[0] == "ponderhit") {
+			// The opponent played the move we pondered on, carry on with the same search on the clock.
+			engine.ponderhit();
+		} else if (commandSegments[0] == "setoption") {
+			// "setoption name Ponder value true": the GUI only tells us it may send "go ponder",
+			// there is nothing to set up for it.
+			// "setoption name Affinity value spread": how perft threads are placed (see numa.h)
+			// "setoption name SearchCache value /path/to/file": results kept across sessions (see
+			// search_cache.h), "<empty>" turns it off. SearchCacheMB applies from the next file on.
+			// "setoption name TraceFile value trace.bin": log every node of the following searches (trace.h).
+			AffinityPolicy policy;
+			if (commandSegments.size() > 4 && commandSegments[2] == "Affinity" && parseAffinityPolicy(commandSegments[4], policy)) {
+				setAffinityPolicy(policy);
+			} else if (commandSegments.size() > 4 && commandSegments[2] == "MultiPV") {
+				engine.setMultiPV(std::atoi(commandSegments[4].c_str()));
+			} else if (commandSegments.size() > 4 && commandSegments[2] == "SearchCacheMB") {
+				searchCacheMB = std::max(1, std::atoi(commandSegments[4].c_str()));
+			} else if (commandSegments.size() > 3 && commandSegments[2] == "TraceFile") {
+				std::string path;
+				for (size_t i = 4; i < commandSegments.size(); i++) {
+					path += (i > 4 ? " " : "") + commandSegments[i];
+				}
+				engine.setTraceLog(nullptr);
+				traceLog.reset();
+				if (!path.empty() && path != "<empty>") {
+					std::shared_ptr<TraceLog> log = std::make_shared<TraceLog>();
+					std::string error;
+					if (log->open(path, error)) {
+						traceLog = log;
+						engine.setTraceLog(traceLog);
+					} else {
+						uciWrite("info string " + error);
+					}
+				}
+			} else if (commandSegments.size() > 3 && commandSegments[2] == "SearchCache") {
+				std::string path;
+				for (size_t i = 4; i < commandSegments.size(); i++) {
+					path += (i > 4 ? " " : "") + commandSegments[i];
+				}
+				engine.setSearchCache(nullptr);
+				searchCache.reset();
+				if (!path.empty() && path != "<empty>") {
+					std::shared_ptr<SearchCache> cache = std::make_shared<SearchCache>();
+					std::string error;
+					if (cache->open(path, searchCacheMB, searchCacheFingerprint(engine.getParams()), error)) {
+						searchCache = cache;
+						engine.setSearchCache(searchCache);
+						uciWrite("info string search cache " + searchCache->describe());
+					} else {
+						uciWrite("info string " + error);
+					}
+				}
+			} else if (commandSegments.size() < 3 || commandSegments[2] != "Ponder") {
+				uciWrite("info string unknown option: " + command);
 			}
-			
-			// 3. If there are legal moves, find the best one and send it.
-			std::string bestMove = search(board);
-			std::cout << "bestmove " << bestMove << std::endl;
-					
 		} else if (commandSegments[0] == "quit") {
+			engine.stop();
 			isRunning = false;
 		} else if (commandSegments[0] == "print") {
-			board.printBoard();
+			engine.stop();
+			engine.board().printBoard();
+		} else if (commandSegments[0] == "cpu") {
+			uciWrite(std::string("build: ") + compiledArchName() + "\n"
+			         + "cpu features: " + cpuFeatureString(cpuFeatures()) + "\n"
+			         + "popcount kernel: " + popCount64KernelName() + "\n"
+			         + "numa: " + numaTopologyString() + ", affinity " + affinityPolicyName(affinityPolicy()));
+		} else if (commandSegments[0] == "profile") {
+			// Breakdown of the cycles counted since the last "profile", e.g. after a go or perft.
+			// A search that is still running is included up to now.
+			printProfile();
 		} else if (commandSegments[0] == "perft") {
-		    if (commandSegments.size() > 1) {
-		        int depth = std::stoi(commandSegments[1]);
-		        PerftTest(board, depth);
-		    } else {
-		        std::cout << "Usage: perft <depth>" << std::endl;
+		    engine.stop();
+		    Board& board = engine.board();
+		    // "perft 5", "perft divide 5", "perft epd perft.epd [maxdepth] [threads]". Anything
+		    // that isn't a positive depth (atoi gives 0 for "abc") gets the usage line.
+		    bool valid = false;
+		    if (commandSegments.size() > 2 && commandSegments[1] == "divide") {
+		        int depth = std::atoi(commandSegments[2].c_str());
+		        if (depth >= 1) {
+		            PerftDivide(board, depth);
+		            valid = true;
+		        }
+		    } else if (commandSegments.size() > 2 && commandSegments[1] == "epd") {
+		        int maxDepth = (commandSegments.size() > 3) ? std::atoi(commandSegments[3].c_str()) : 4;
+		        int threads = (commandSegments.size() > 4) ? std::atoi(commandSegments[4].c_str()) : 0;
+		        if (maxDepth >= 1 && threads >= 0) {
+		            PerftEpdSuite(commandSegments[2], maxDepth, threads);
+		            valid = true;
+		        }
+		    } else if (commandSegments.size() > 1) {
+		        int depth = std::atoi(commandSegments[1].c_str());
+		        if (depth >= 1) {
+		            PerftTest(board, depth);
+		            valid = true;
+		        }
+		    }
+		    if (!valid) {
+		        uciWrite("Usage: perft <depth> | perft divide <depth> | perft epd <file> [maxdepth] [threads]");
 		    }
 		} else {
-			std::cout << "I don't know that command yet: " << command << std::endl;
+			uciWrite("I don't know that command yet: " + command);
 		}
 	}
 	
@@ -3,7 +3,17 @@
 
 #include <string>
 #include <vector>
+#include "board.h"
+#include "search.h"
 
 std::vector<std::string> parseCommand(std::string command);
+// "position startpos moves e2e4" / "position fen <fen> moves e2e4": base is "startpos" or the FEN.
+bool parsePositionCommand(const std::vector<std::string>& commandSegments, std::string& base, std::vector<std::string>& moves);
+// "go wtime 300000 btime 300000 winc 2000 binc 2000 movestogo 40 depth 12 nodes 100000 movetime 500 infinite ponder"
+// Without any limit the search stops at DEFAULT_SEARCH_DEPTH.
+SearchLimits parseGoLimits(const std::vector<std::string>& commandSegments, PieceColor sideToMove, bool& ponder);
+
+// The UCI loop on stdin/stdout.
+int runUci();
 
 #endif
\ No newline at end of file